@@ -0,0 +1,221 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "store.h"
+
+#define BENCH_GAMES MAX_PLAYS   // игр в хранилище
+#define BENCH_FINDS 1000000     // поисков на замер
+#define BENCH_LISTS 100         // проходов do_list
+#define CHECK_PAIRS 400000      // случайных пар (секрет, попытка) на сверку с эталоном
+#define CHECK_SET 4096          // пар в замере скорости (помещаются в кэш)
+#define CHECK_CALLS 20000000    // вызовов на замер
+
+// Хранилище на BENCH_GAMES игр: поиск по названию и проход do_list
+// Возвращает: 0 если все игры находятся по своим названиям, 1 иначе
+int bench_store() {
+    PlayStore st;
+    store_init(&st);
+
+    char name[MAX_GAME_ID];
+    uint64_t start = now_us();
+    for (int i = 0; i < BENCH_GAMES; i++) {
+        snprintf(name, sizeof(name), "game-%d", i);
+        int g = store_add(&st, name, 2, WORD_LENGTH);
+        if (g == -1) {
+            printf("store_add: нет памяти на игре %d\n", i);
+            store_free(&st);
+            return 1;
+        }
+        st.run[g] = (uint8_t)(i % 3 != 0);
+    }
+    uint64_t added = now_us() - start;
+
+    // Поиск существующих игр в случайном порядке; названия готовим заранее,
+    // чтобы в замер не попал snprintf
+    int *want = malloc(BENCH_FINDS * sizeof(int));
+    char (*names)[16] = malloc(BENCH_FINDS * sizeof(*names));
+    if (want == NULL || names == NULL) {
+        free(want);
+        free(names);
+        store_free(&st);
+        return 1;
+    }
+    srand(1);
+    for (int i = 0; i < BENCH_FINDS; i++) {
+        want[i] = rand() % BENCH_GAMES;
+        snprintf(names[i], sizeof(names[i]), "game-%d", want[i]);
+    }
+
+    int bad = 0;
+    start = now_us();
+    for (int i = 0; i < BENCH_FINDS; i++) {
+        bad += store_find(&st, names[i]) != want[i];
+    }
+    uint64_t hits = now_us() - start;
+    free(want);
+    free(names);
+
+    // Поиск отсутствующих: название известно пулу (как логин), но игры с ним нет
+    store_add_user(&st, 0, "nobody");
+    start = now_us();
+    for (int i = 0; i < BENCH_FINDS; i++) {
+        bad += store_find(&st, "nobody") != -1;
+    }
+    uint64_t misses = now_us() - start;
+
+    // Проход do_list: подсчёт идущих игр по плотному массиву run
+    volatile int total = 0;
+    start = now_us();
+    for (int k = 0; k < BENCH_LISTS; k++) {
+        int n = 0;
+        for (int i = 0; i < st.cnt; i++) {
+            n += st.run[i];
+        }
+        total = n;
+    }
+    uint64_t lists = now_us() - start;
+
+    printf("Хранилище: %d игр, добавление %.1f мс (%.0f нс/игру)\n",
+        st.cnt, added / 1000.0, added * 1000.0 / BENCH_GAMES);
+    printf("  store_find, есть игра:  %6.1f нс/вызов\n", hits * 1000.0 / BENCH_FINDS);
+    printf("  store_find, нет игры:   %6.1f нс/вызов\n", misses * 1000.0 / BENCH_FINDS);
+    printf("  do_list (%d идущих):   %6.3f мс/проход\n", total, lists / 1000.0 / BENCH_LISTS);
+    if (bad > 0) {
+        printf("  ОШИБКА: неверных результатов поиска: %d\n", bad);
+    }
+
+    store_free(&st);
+    return bad > 0;
+}
+
+// Эталон: подсчёт через счётчики букв (алгоритм до ядер по длине, без ограничения в 5 букв)
+void check_ref(const char *secret, const char *guess, int len, int *bulls, int *cows) {
+    int secret_cnt[26] = {0};
+    int guess_cnt[26] = {0};
+    *bulls = 0;
+    *cows = 0;
+
+    for (int i = 0; i < len; i++) {
+        if (secret[i] == guess[i]) {
+            (*bulls)++;
+        } else {
+            secret_cnt[secret[i] - 'a']++;
+            guess_cnt[guess[i] - 'a']++;
+        }
+    }
+    for (int i = 0; i < 26; i++) {
+        *cows += secret_cnt[i] < guess_cnt[i] ? secret_cnt[i] : guess_cnt[i];
+    }
+}
+
+// Прежний цикл с фиксированной длиной 5 - с ним сравнивается ядро check_word_5
+void check_old5(const char *secret, const char *guess, int *bulls, int *cows) {
+    int secret_cnt[26] = {0};
+    int guess_cnt[26] = {0};
+    *bulls = 0;
+    *cows = 0;
+
+    for (int i = 0; i < WORD_LENGTH; i++) {
+        if (secret[i] == guess[i]) {
+            (*bulls)++;
+        } else {
+            secret_cnt[secret[i] - 'a']++;
+            guess_cnt[guess[i] - 'a']++;
+        }
+    }
+    for (int i = 0; i < 26; i++) {
+        *cows += secret_cnt[i] < guess_cnt[i] ? secret_cnt[i] : guess_cnt[i];
+    }
+}
+
+// Случайное слово длины len; маленький алфавит, чтобы чаще повторялись буквы
+void rand_word(char *w, int len) {
+    int abc = rand() % 2 ? 4 : 26;
+    for (int i = 0; i < len; i++) {
+        w[i] = (char)('a' + rand() % abc);
+    }
+    w[len] = 0;
+}
+
+// Ядра подсчёта быков и коров по длинам слова:
+// сверка с эталоном на всех парах словаря и CHECK_PAIRS случайных парах, затем нс на вызов
+// Возвращает: 0 если все результаты совпали, 1 иначе
+int bench_check() {
+    static char secret[CHECK_SET][MAX_WORD_LENGTH + 1];
+    static char guess[CHECK_SET][MAX_WORD_LENGTH + 1];
+    int bad_all = 0;
+
+    printf("\nБукв  Сверено пар  Расхождений  check_word, нс  эталон, нс\n");
+    for (int len = MIN_WORD_LENGTH; len <= MAX_WORD_LENGTH; len++) {
+        const Dict *d = dict_get(len);
+        long pairs = 0;
+        int bad = 0;
+        int b1, c1, b2, c2;
+
+        for (int i = 0; i < d->cnt; i++) {
+            for (int j = 0; j < d->cnt; j++, pairs++) {
+                check_word(d->words[i], d->words[j], len, &b1, &c1);
+                check_ref(d->words[i], d->words[j], len, &b2, &c2);
+                bad += b1 != b2 || c1 != c2;
+            }
+        }
+
+        char s[MAX_WORD_LENGTH + 1], g[MAX_WORD_LENGTH + 1];
+        for (int i = 0; i < CHECK_PAIRS; i++, pairs++) {
+            rand_word(s, len);
+            rand_word(g, len);
+            check_word(s, g, len, &b1, &c1);
+            check_ref(s, g, len, &b2, &c2);
+            bad += b1 != b2 || c1 != c2;
+        }
+
+        // Замер: пары из словаря, как у сервера
+        for (int i = 0; i < CHECK_SET; i++) {
+            strcpy(secret[i], d->words[rand() % d->cnt]);
+            strcpy(guess[i], d->words[rand() % d->cnt]);
+        }
+
+        volatile int sink = 0;
+        uint64_t start = now_us();
+        for (int i = 0; i < CHECK_CALLS; i++) {
+            int k = i & (CHECK_SET - 1);
+            check_word(secret[k], guess[k], len, &b1, &c1);
+            sink += b1 + c1;
+        }
+        uint64_t kernel = now_us() - start;
+
+        start = now_us();
+        for (int i = 0; i < CHECK_CALLS; i++) {
+            int k = i & (CHECK_SET - 1);
+            check_ref(secret[k], guess[k], len, &b1, &c1);
+            sink += b1 + c1;
+        }
+        uint64_t ref = now_us() - start;
+
+        printf("%-5d %-12ld %-12d %14.2f %11.2f\n", len, pairs, bad,
+            kernel * 1000.0 / CHECK_CALLS, ref * 1000.0 / CHECK_CALLS);
+
+        if (len == WORD_LENGTH) {
+            start = now_us();
+            for (int i = 0; i < CHECK_CALLS; i++) {
+                int k = i & (CHECK_SET - 1);
+                check_old5(secret[k], guess[k], &b1, &c1);
+                sink += b1 + c1;
+            }
+            uint64_t old = now_us() - start;
+            printf("      прежний цикл на %d букв: %.2f нс\n", WORD_LENGTH, old * 1000.0 / CHECK_CALLS);
+        }
+        bad_all += bad;
+    }
+
+    if (bad_all > 0) {
+        printf("ОШИБКА: check_word расходится с эталоном в %d парах\n", bad_all);
+    }
+    return bad_all > 0;
+}
+
+// Точка входа: замеры горячих путей сервера без сети
+int main() {
+    int rc = bench_store();
+    rc |= bench_check();
+    return rc;
+}
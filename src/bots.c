@@ -0,0 +1,620 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "func.h"
+
+#include <unistd.h>
+
+#define SERV "tcp://localhost:5555"
+#define MAX_SOCKS 64
+#define REQ_TIMEOUT 1000
+#define REQ_RETRIES 4
+#define RECONNECT_IVL 10    // мс, чтобы пережить перезапуск сервера без заметной паузы
+#define SCAN_PERIOD 50000
+
+// Состояние виртуального игрока (конечный автомат вместо отдельного процесса)
+typedef enum {
+    ST_WAIT,    // игрок ждёт MSG_GAME_OK создателя, создатель - входа остальных игроков
+    ST_NEW,     // отправлен MSG_NEW_GAME
+    ST_JOIN,    // отправлен MSG_JOIN_BY_ID
+    ST_QUICK,   // отправлен MSG_QUICK_JOIN
+    ST_TRY,     // отправлен MSG_MAKE_TRY
+    ST_QUIT,    // отправлен MSG_QUIT_GAME
+    ST_DONE,
+} BotState;
+
+// Виртуальный игрок: несколько десятков байт вместо процесса с сокетом
+// Имя игрока и игры не хранятся, а строятся из номеров (bot<idx>, bots-<pid>-<host>)
+typedef struct {
+    BotState st;
+    int host;                       // номер создателя игры
+    int joining;                    // у создателя: сколько игроков ещё входят в игру
+    int tries;
+    int won;
+    int failed;
+    uint32_t seq;                   // номер текущего запроса этого игрока
+    uint64_t retry_at;              // когда повторить запрос после отказа "busy" (0 - не нужно)
+    int resends;                    // повторов текущего запроса после таймаута
+    uint64_t cand;                  // маска слов словаря, ещё совместимых с ответами
+    char guess[MAX_WORD_LENGTH + 1];
+    char game[MAX_GAME_ID];         // игра, выданная подбором (только с -q)
+
+    // Задержки
+    uint64_t first_us;              // первая отправка текущего запроса
+    uint64_t sent_us;               // последняя отправка (для таймаута)
+    uint32_t req_cnt;
+    uint64_t lat_sum;
+    uint32_t lat_max;
+} Bot;
+
+// Стратегия угадывания: pick выбирает слово, learn учитывает ответ сервера
+typedef struct {
+    const char *name;
+    void (*pick)(Bot *b, char *guess);
+    void (*learn)(Bot *b, const char *guess, int bulls, int cows);
+} Strategy;
+
+Bot *bots = NULL;
+int bots_cnt = 100;
+int socks_cnt = 4;
+int per_game = 2;
+int word_len = WORD_LENGTH;
+const Dict *dict = NULL;
+int verbose = 0;
+int quick = 0;                  // игры подбирает сервер (MSG_QUICK_JOIN)
+int quick_new = 0;              // сколько игр создано подбором
+int done_cnt = 0;
+int retry_cnt = 0;
+long busy_cnt = 0;
+long resend_cnt = 0;
+long lost_cnt = 0;
+const Strategy *strat = NULL;
+void *socks[MAX_SOCKS];
+
+uint32_t *lat_all = NULL;
+size_t lat_cnt = 0;
+size_t lat_cap = 0;
+
+uint32_t *rec_all = NULL;       // время восстановления запросов, которые пришлось повторять
+size_t rec_cnt = 0;
+size_t rec_cap = 0;
+
+uint64_t rnd_state = 88172645463325252ull;
+
+// Псевдослучайное число (xorshift64), один поток - одно состояние
+uint32_t rnd() {
+    rnd_state ^= rnd_state << 13;
+    rnd_state ^= rnd_state >> 7;
+    rnd_state ^= rnd_state << 17;
+    return (uint32_t)rnd_state;
+}
+
+// Стратегия "random": любое слово словаря, ответы не учитываются
+void pick_random(Bot *b, char *guess) {
+    (void)b;
+    strcpy(guess, dict->words[rnd() % dict->cnt]);
+}
+
+void learn_none(Bot *b, const char *guess, int bulls, int cows) {
+    (void)b;
+    (void)guess;
+    (void)bulls;
+    (void)cows;
+}
+
+// Стратегия "filter": случайное слово из тех, что совместимы со всеми прошлыми ответами
+void pick_filter(Bot *b, char *guess) {
+    int left = __builtin_popcountll(b->cand);
+    if (left == 0) {
+        pick_random(b, guess);
+        return;
+    }
+
+    int k = (int)(rnd() % left);
+    for (int i = 0; i < dict->cnt; i++) {
+        if ((b->cand >> i & 1) && k-- == 0) {
+            strcpy(guess, dict->words[i]);
+            return;
+        }
+    }
+}
+
+// Убирает из кандидатов слова, для которых ответ на guess был бы другим
+void learn_filter(Bot *b, const char *guess, int bulls, int cows) {
+    for (int i = 0; i < dict->cnt; i++) {
+        if (!(b->cand >> i & 1)) {
+            continue;
+        }
+        int wb = 0, wc = 0;
+        check_word(dict->words[i], guess, word_len, &wb, &wc);
+        if (wb != bulls || wc != cows) {
+            b->cand &= ~(1ull << i);
+        }
+    }
+}
+
+const Strategy strategies[] = {
+    {"random", pick_random, learn_none},
+    {"filter", pick_filter, learn_filter},
+};
+
+// Собирает запрос для текущего шага игрока (аналог make_game/join_game/game_play)
+// Параметры: idx - номер игрока, r - сообщение для заполнения
+void bot_msg(int idx, Msg *r) {
+    Bot *b = &bots[idx];
+    msg_create(r);
+
+    switch (b->st) {
+        case ST_NEW:
+            r->cmd = MSG_NEW_GAME;
+            r->player_cnt = per_game;
+            r->word_len = word_len;
+            break;
+        case ST_JOIN:
+            r->cmd = MSG_JOIN_BY_ID;
+            break;
+        case ST_QUICK:
+            r->cmd = MSG_QUICK_JOIN;
+            r->player_cnt = per_game;
+            r->word_len = word_len;
+            break;
+        case ST_TRY:
+            r->cmd = MSG_MAKE_TRY;
+            strcpy(r->word, b->guess);
+            break;
+        default:
+            r->cmd = MSG_QUIT_GAME;
+            break;
+    }
+
+    if (quick) {
+        // Подбор смешивает игроков разных процессов - имена должны различаться
+        snprintf(r->user_name, sizeof(r->user_name), "bot%d-%d", (int)getpid(), idx);
+        strcpy(r->game_id, b->game);
+    } else {
+        snprintf(r->user_name, sizeof(r->user_name), "bot%d", idx);
+        snprintf(r->game_id, MAX_GAME_ID, "bots-%d-%d", (int)getpid(), b->host);
+    }
+}
+
+// Отправляет запрос текущего шага: номер запроса кодирует номер игрока
+// Параметры: idx - номер игрока, fresh - 1 для нового запроса,
+// 0 для повтора (после таймаута - с тем же req_id, чтобы сервер не засчитал попытку дважды)
+void bot_send(int idx, int fresh) {
+    Bot *b = &bots[idx];
+    void *s = socks[idx % socks_cnt];
+    Msg r;
+
+    bot_msg(idx, &r);
+
+    b->sent_us = now_us();
+    if (fresh) {
+        b->seq++;
+        b->first_us = b->sent_us;
+        b->resends = 0;
+    }
+    r.req_id = b->seq * (uint32_t)bots_cnt + (uint32_t)idx;
+
+    zmq_send(s, "", 0, ZMQ_SNDMORE);
+    zmq_send(s, &r, sizeof(Msg), 0);
+}
+
+// Аналог make_game: создатель игры отправляет MSG_NEW_GAME
+void bot_new(int idx) {
+    bots[idx].st = ST_NEW;
+    bot_send(idx, 1);
+}
+
+// Аналог join_game: игрок присоединяется к игре своего создателя
+void bot_join(int idx) {
+    bots[idx].st = ST_JOIN;
+    bot_send(idx, 1);
+}
+
+// Аналог quick_join: сервер сам выбирает игру или создаёт новую
+void bot_quick(int idx) {
+    bots[idx].st = ST_QUICK;
+    bot_send(idx, 1);
+}
+
+// Одна итерация game_play: выбор слова стратегией и MSG_MAKE_TRY
+void bot_try(int idx) {
+    Bot *b = &bots[idx];
+    strat->pick(b, b->guess);
+    b->st = ST_TRY;
+    bot_send(idx, 1);
+}
+
+// Игрок idx вошёл в игру или не смог войти: когда решились все входы,
+// создатель начинает угадывать. Раньше нельзя: угадав с первой попытки,
+// он закончил бы игру, и опоздавшие получили бы "Game ended"
+void bot_joined(int idx) {
+    int h = bots[idx].host;
+    if (--bots[h].joining == 0 && bots[h].st == ST_WAIT) {
+        bot_try(h);
+    }
+}
+
+// Выход из игры (как в конце game_play)
+void bot_quit(int idx) {
+    bots[idx].st = ST_QUIT;
+    bot_send(idx, 1);
+}
+
+// Завершает игрока без обращения к серверу
+void bot_done(int idx) {
+    bots[idx].st = ST_DONE;
+    done_cnt++;
+}
+
+// Добавляет значение в растущий массив выборки
+void sample_add(uint32_t **arr, size_t *cnt, size_t *cap, uint32_t v) {
+    if (*cnt == *cap) {
+        size_t n = *cap ? *cap * 2 : 4096;
+        uint32_t *tmp = realloc(*arr, n * sizeof(uint32_t));
+        if (tmp == NULL) {
+            return;
+        }
+        *arr = tmp;
+        *cap = n;
+    }
+    (*arr)[(*cnt)++] = v;
+}
+
+// Запоминает задержку ответа (от первой отправки) для игрока и для общей статистики;
+// если были повторы - ещё и время восстановления
+void bot_latency(Bot *b) {
+    uint64_t d = now_us() - b->first_us;
+    uint32_t lat = d > UINT32_MAX ? UINT32_MAX : (uint32_t)d;
+
+    b->req_cnt++;
+    b->lat_sum += lat;
+    if (lat > b->lat_max) {
+        b->lat_max = lat;
+    }
+
+    sample_add(&lat_all, &lat_cnt, &lat_cap, lat);
+    if (b->resends > 0) {
+        sample_add(&rec_all, &rec_cnt, &rec_cap, lat);
+    }
+}
+
+// Повторяет последний запрос игрока после отказа "busy"
+// Номер новый (ответ на прежний уже пришёл), но это тот же запрос:
+// first_us не сбрасывается, и ожидание retry_ms входит в его задержку
+void bot_resend(int idx) {
+    Bot *b = &bots[idx];
+    b->retry_at = 0;
+    retry_cnt--;
+
+    b->seq++;
+    b->resends = 0;
+    bot_send(idx, 0);
+}
+
+// Проверяет, не истёк ли таймаут ответа; повторяет запрос с тем же req_id
+// с экспоненциальной задержкой, после REQ_RETRIES повторов сдаётся
+// Параметры: idx - номер игрока, now - текущее время в мкс
+void bot_check_timeout(int idx, uint64_t now) {
+    Bot *b = &bots[idx];
+
+    if (b->st == ST_WAIT || b->st == ST_DONE || b->retry_at != 0) {
+        return;
+    }
+
+    // Повтор после "busy" мог уйти уже после снятия now в этом же проходе цикла
+    uint64_t timeout = (uint64_t)REQ_TIMEOUT << b->resends;
+    if (now < b->sent_us || now - b->sent_us < timeout * 1000) {
+        return;
+    }
+
+    if (b->resends >= REQ_RETRIES) {
+        b->failed = 1;
+        lost_cnt++;
+        int joining = b->st == ST_JOIN;
+        bot_done(idx);
+        if (joining) {
+            bot_joined(idx);
+        }
+        return;
+    }
+
+    b->resends++;
+    resend_cnt++;
+    bot_send(idx, 0);
+}
+
+// Продвигает автомат игрока по ответу сервера
+// Параметры: p - ответ; игрок определяется по req_id
+void bot_step(Msg *p) {
+    int idx = (int)(p->req_id % (uint32_t)bots_cnt);
+    Bot *b = &bots[idx];
+
+    if (p->req_id / (uint32_t)bots_cnt != b->seq || b->st == ST_DONE) {
+        return; // устаревший или чужой ответ
+    }
+
+    // Сервер перегружен - повторим тот же шаг через retry_ms.
+    // Отказ - не ответ на запрос: в задержки и запр/с он не идёт, считается отдельно
+    if (p->cmd == MSG_FAIL && p->retry_ms > 0) {
+        b->retry_at = now_us() + (uint64_t)p->retry_ms * 1000;
+        retry_cnt++;
+        busy_cnt++;
+        return;
+    }
+
+    bot_latency(b);
+
+    switch (b->st) {
+        case ST_NEW:
+            if (p->cmd == MSG_FAIL) {
+                printf("bot%d: %s\n", idx, p->msg);
+                for (int i = idx; i < idx + per_game && i < bots_cnt; i++) {
+                    bots[i].failed = 1;
+                    bot_done(i);
+                }
+                break;
+            }
+            for (int i = idx + 1; i < idx + per_game && i < bots_cnt; i++) {
+                bot_join(i);
+                b->joining++;
+            }
+            if (b->joining > 0) {
+                b->st = ST_WAIT;
+            } else {
+                bot_try(idx);
+            }
+            break;
+        case ST_JOIN:
+            if (p->cmd == MSG_FAIL) {
+                b->failed = 1;
+                bot_done(idx);
+            } else {
+                bot_try(idx);
+            }
+            bot_joined(idx);
+            break;
+        case ST_QUICK:
+            if (p->cmd == MSG_FAIL) {
+                printf("bot%d: %s\n", idx, p->msg);
+                b->failed = 1;
+                bot_done(idx);
+                break;
+            }
+            snprintf(b->game, sizeof(b->game), "%s", p->game_id);
+            quick_new += p->player_cnt == 1;
+            bot_try(idx);
+            break;
+        case ST_TRY:
+            if (p->cmd == MSG_FAIL) {
+                b->failed = 1;
+                bot_quit(idx);
+                break;
+            }
+            b->tries++;
+            if (p->cmd == MSG_WIN) {
+                b->won = 1;
+                bot_quit(idx);
+                break;
+            }
+            strat->learn(b, b->guess, p->res.bulls, p->res.cows);
+            if (b->tries >= MAX_ATTEMPTS) {
+                bot_quit(idx);
+            } else {
+                bot_try(idx);
+            }
+            break;
+        case ST_QUIT:
+            bot_done(idx);
+            break;
+        default:
+            break;
+    }
+}
+
+int cmp_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+// Печатает задержки по игрокам (с -v) и общую сводку с перцентилями
+void report(uint64_t elapsed_us) {
+    int won = 0, failed = 0;
+    uint64_t tries = 0;
+
+    for (int i = 0; i < bots_cnt; i++) {
+        Bot *b = &bots[i];
+        won += b->won;
+        failed += b->failed;
+        tries += (uint64_t)b->tries;
+
+        if (verbose) {
+            printf("bot%-6d запросов %4u  среднее %8.3f мс  макс %8.3f мс  попыток %3d  %s\n",
+                i, b->req_cnt, b->req_cnt ? b->lat_sum / 1000.0 / b->req_cnt : 0.0,
+                b->lat_max / 1000.0, b->tries, b->won ? "победа" : (b->failed ? "ошибка" : "-"));
+        }
+    }
+
+    qsort(lat_all, lat_cnt, sizeof(uint32_t), cmp_u32);
+
+    printf("\n==============================\n");
+    printf("Игроков: %d (стратегия %s, сокетов %d, букв %d)\n", bots_cnt, strat->name, socks_cnt, word_len);
+    printf("Побед: %d, ошибок: %d, не завершили: %d\n", won, failed, bots_cnt - done_cnt);
+    printf("Попыток в среднем: %.2f\n", bots_cnt ? (double)tries / bots_cnt : 0.0);
+    printf("Отказов \"busy\": %ld, повторов по таймауту: %ld, потеряно запросов: %ld\n",
+        busy_cnt, resend_cnt, lost_cnt);
+    printf("Запросов: %zu за %.3f с (%.0f запр/с)\n", lat_cnt, elapsed_us / 1e6,
+        elapsed_us ? lat_cnt * 1e6 / elapsed_us : 0.0);
+    if (quick && quick_new > 0) {
+        printf("Подбор: создано игр %d, игроков на игру %.2f\n", quick_new, (double)bots_cnt / quick_new);
+    }
+
+    if (lat_cnt > 0) {
+        uint64_t sum = 0;
+        for (size_t i = 0; i < lat_cnt; i++) {
+            sum += lat_all[i];
+        }
+        printf("Задержка, мс: среднее %.3f  p50 %.3f  p90 %.3f  p99 %.3f  макс %.3f\n",
+            sum / 1000.0 / lat_cnt,
+            lat_all[lat_cnt / 2] / 1000.0,
+            lat_all[lat_cnt * 90 / 100] / 1000.0,
+            lat_all[lat_cnt * 99 / 100] / 1000.0,
+            lat_all[lat_cnt - 1] / 1000.0);
+    }
+
+    if (rec_cnt > 0) {
+        qsort(rec_all, rec_cnt, sizeof(uint32_t), cmp_u32);
+        printf("Восстановление после потери ответа (%zu запр), мс: p50 %.3f  p99 %.3f  макс %.3f\n",
+            rec_cnt,
+            rec_all[rec_cnt / 2] / 1000.0,
+            rec_all[rec_cnt * 99 / 100] / 1000.0,
+            rec_all[rec_cnt - 1] / 1000.0);
+    }
+    printf("==============================\n");
+}
+
+void usage(const char *prog) {
+    printf("Использование: %s [-n игроков] [-s сокетов] [-k игроков в игре] [-l длина слова] [-t random|filter] [-a адрес] [-q] [-v]\n", prog);
+    printf("  -q  игры подбирает сервер (MSG_QUICK_JOIN), -k - размер создаваемых игр\n");
+}
+
+// Точка входа: много виртуальных игроков поверх нескольких DEALER сокетов в одном цикле zmq_poll
+// Игроки разбиваются на группы по -k: первый создаёт игру, остальные присоединяются,
+// затем все угадывают слово выбранной стратегией и выходят
+int main(int argc, char **argv) {
+    const char *addr = SERV;
+    const char *strat_name = "filter";
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:s:k:l:t:a:qv")) != -1) {
+        switch (opt) {
+            case 'n': bots_cnt = atoi(optarg); break;
+            case 's': socks_cnt = atoi(optarg); break;
+            case 'k': per_game = atoi(optarg); break;
+            case 'l': word_len = atoi(optarg); break;
+            case 't': strat_name = optarg; break;
+            case 'a': addr = optarg; break;
+            case 'q': quick = 1; break;
+            case 'v': verbose = 1; break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    for (size_t i = 0; i < sizeof(strategies) / sizeof(strategies[0]); i++) {
+        if (strcmp(strategies[i].name, strat_name) == 0) {
+            strat = &strategies[i];
+        }
+    }
+
+    dict = dict_get(word_len);
+
+    if (strat == NULL || dict == NULL || dict->cnt > 64 || bots_cnt < 1 || socks_cnt < 1 ||
+        socks_cnt > MAX_SOCKS || per_game < 1 || per_game > MAX_GAME_PLAYERS) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    bots = calloc((size_t)bots_cnt, sizeof(Bot));
+    if (bots == NULL) {
+        printf("Нет памяти\n");
+        return 1;
+    }
+
+    rnd_state ^= now_us() ^ (uint64_t)getpid() << 32;
+
+    void *ctx = zmq_ctx_new();
+    zmq_pollitem_t items[MAX_SOCKS];
+    int hwm = 0;
+    int ivl = RECONNECT_IVL;
+
+    for (int i = 0; i < socks_cnt; i++) {
+        socks[i] = zmq_socket(ctx, ZMQ_DEALER);
+        zmq_setsockopt(socks[i], ZMQ_SNDHWM, &hwm, sizeof(hwm));
+        zmq_setsockopt(socks[i], ZMQ_RCVHWM, &hwm, sizeof(hwm));
+        zmq_setsockopt(socks[i], ZMQ_RECONNECT_IVL, &ivl, sizeof(ivl));
+        if (zmq_connect(socks[i], addr) != 0) {
+            printf("Ошибка подключения\n");
+            return 1;
+        }
+        items[i].socket = socks[i];
+        items[i].fd = 0;
+        items[i].events = ZMQ_POLLIN;
+        items[i].revents = 0;
+    }
+
+    printf("Запуск %d игроков на %s...\n", bots_cnt, addr);
+
+    uint64_t start = now_us();
+
+    for (int i = 0; i < bots_cnt; i++) {
+        bots[i].host = i - i % per_game;
+        bots[i].cand = dict->cnt == 64 ? ~0ull : (1ull << dict->cnt) - 1;
+    }
+    for (int i = 0; i < bots_cnt; i += quick ? 1 : per_game) {
+        if (quick) {
+            bot_quick(i);
+        } else {
+            bot_new(i);
+        }
+    }
+
+    uint64_t last_scan = now_us();
+
+    while (done_cnt < bots_cnt) {
+        int rc = zmq_poll(items, socks_cnt, retry_cnt > 0 ? 1 : SCAN_PERIOD / 1000);
+        if (rc < 0) {
+            break;
+        }
+
+        uint64_t now = now_us();
+
+        if (retry_cnt > 0) {
+            for (int i = 0; i < bots_cnt && retry_cnt > 0; i++) {
+                if (bots[i].retry_at != 0 && bots[i].retry_at <= now) {
+                    bot_resend(i);
+                }
+            }
+        }
+
+        // Запросы без ответа (сервер перезапущен или ответ потерян)
+        if (now - last_scan >= SCAN_PERIOD) {
+            for (int i = 0; i < bots_cnt; i++) {
+                bot_check_timeout(i, now);
+            }
+            last_scan = now;
+        }
+
+        for (int i = 0; i < socks_cnt; i++) {
+            if (!(items[i].revents & ZMQ_POLLIN)) {
+                continue;
+            }
+
+            // Забираем все накопившиеся ответы с сокета
+            while (1) {
+                char sep[10];
+                if (zmq_recv(socks[i], sep, sizeof(sep), ZMQ_DONTWAIT) == -1) {
+                    break;
+                }
+                Msg p;
+                if (zmq_recv(socks[i], &p, sizeof(Msg), 0) == (int)sizeof(Msg)) {
+                    bot_step(&p);
+                }
+            }
+        }
+    }
+
+    report(now_us() - start);
+
+    for (int i = 0; i < socks_cnt; i++) {
+        int linger = 0;
+        zmq_setsockopt(socks[i], ZMQ_LINGER, &linger, sizeof(linger));
+        zmq_close(socks[i]);
+    }
+    zmq_ctx_destroy(ctx);
+
+    free(bots);
+    free(lat_all);
+    free(rec_all);
+    return 0;
+}
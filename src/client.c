@@ -1,32 +1,162 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include "func.h"
 
 #include <ctype.h>
 #include <unistd.h>
 
 #define SERV "tcp://localhost:5555"
+#define REQ_TIMEOUT 1000
+#define REQ_TIMEOUT_MAX 8000
+#define REQ_RETRIES 4
+#define REQ_BUSY_WAIT 30000 // мс: сколько всего ждать, пока сервер отвечает "busy" (не считается потерей)
+#define RECONNECT_IVL 10    // мс: при перезапуске сервера переподключаемся почти сразу
+
+// Соединение с сервером: сокет пересоздаётся, если ответ не пришёл вовремя (Lazy Pirate)
+typedef struct {
+    void *ctx;
+    void *sock;
+    const char *addr;
+    uint32_t next_id;   // монотонный номер запроса, повторы идут с тем же номером
+} Conn;
+
+char serv_addr[256] = SERV;
+
+void game_play(Conn *c, const char *u, const char *g, int len);
 
-void game_play(void *s, const char *u, const char *g);
+// Текущее монотонное время в миллисекундах
+uint64_t now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+void sleep_ms(int ms) {
+    struct timespec ts;
+    ts.tv_sec = ms / 1000;
+    ts.tv_nsec = (long)(ms % 1000) * 1000000;
+    nanosleep(&ts, NULL);
+}
+
+// (Пере)создаёт DEALER сокет и подключается к серверу
+// Старый сокет закрывается без ожидания: неотправленные и опоздавшие сообщения выбрасываются
+// Возвращает: 0 при успехе, -1 при ошибке
+int conn_open(Conn *c) {
+    int linger = 0;
+    int ivl = RECONNECT_IVL;
+    
+    if (c->sock != NULL) {
+        zmq_close(c->sock);
+    }
+    
+    c->sock = zmq_socket(c->ctx, ZMQ_DEALER);
+    if (c->sock == NULL) {
+        return -1;
+    }
+    zmq_setsockopt(c->sock, ZMQ_LINGER, &linger, sizeof(linger));
+    zmq_setsockopt(c->sock, ZMQ_RECONNECT_IVL, &ivl, sizeof(ivl));
+    
+    return zmq_connect(c->sock, c->addr);
+}
 
 int send_msg(void *s, Msg *m) {
-    zmq_send(s, "", 0, ZMQ_SNDMORE);
+    if (zmq_send(s, "", 0, ZMQ_SNDMORE) == -1) {
+        return -1;
+    }
     return zmq_send(s, m, sizeof(Msg), 0);
 }
 
-int recv_msg(void *s, Msg *m) {
-    char sep[10];
-    zmq_recv(s, sep, 10, 0);
-    return zmq_recv(s, m, sizeof(Msg), 0);
+// Ждёт ответ с нужным req_id не дольше timeout мс, чужие (опоздавшие) ответы пропускает
+// Возвращает: 1 если ответ получен, 0 по таймауту
+int recv_msg(void *s, Msg *m, uint32_t req_id, int timeout) {
+    uint64_t deadline = now_ms() + (uint64_t)timeout;
+    
+    while (1) {
+        uint64_t now = now_ms();
+        if (now >= deadline) {
+            return 0;
+        }
+        
+        zmq_pollitem_t item = {s, 0, ZMQ_POLLIN, 0};
+        if (zmq_poll(&item, 1, (long)(deadline - now)) <= 0) {
+            continue;
+        }
+        
+        char sep[10];
+        if (zmq_recv(s, sep, 10, 0) == -1) {
+            continue;
+        }
+        if (zmq_recv(s, m, sizeof(Msg), 0) != (int)sizeof(Msg)) {
+            continue;
+        }
+        if (m->req_id == req_id) {
+            return 1;
+        }
+    }
+}
+
+// Отправляет запрос и ждёт ответ с таймаутом
+// Если ответа нет - пересоздаёт сокет и повторяет с тем же req_id, удваивая таймаут;
+// на отказ "busy" ждёт retry_ms и повторяет: сервер ответил, поэтому такой повтор
+// не тратит REQ_RETRIES, а ограничен общим временем REQ_BUSY_WAIT
+// Параметры: c - соединение, r - запрос (req_id заполняется здесь), p - ответ
+// Возвращает: 0 если ответ получен, -1 если сервер так и не ответил
+int request(Conn *c, Msg *r, Msg *p) {
+    r->req_id = ++c->next_id;
+    if (r->req_id == 0) {
+        r->req_id = ++c->next_id;   // 0 - "без номера", сервер такие не сверяет
+    }
+    
+    uint64_t start = now_ms();
+    int timeout = REQ_TIMEOUT;
+    int lost = 0;
+    int attempt = 0;
+    
+    while (1) {
+        if (send_msg(c->sock, r) != -1 && recv_msg(c->sock, p, r->req_id, timeout)) {
+            if (p->cmd == MSG_FAIL && p->retry_ms > 0) {
+                if (now_ms() - start + (uint64_t)p->retry_ms > REQ_BUSY_WAIT) {
+                    printf("Сервер перегружен\n");
+                    return -1;
+                }
+                printf("[сеть] сервер занят, повтор через %d мс\n", p->retry_ms);
+                sleep_ms(p->retry_ms);
+                continue;
+            }
+            if (lost) {
+                printf("[сеть] ответ получен через %llu мс\n", (unsigned long long)(now_ms() - start));
+            }
+            return 0;
+        }
+        
+        lost = 1;
+        if (attempt == REQ_RETRIES) {
+            break;
+        }
+        attempt++;
+        printf("[сеть] нет ответа за %d мс, переподключение (%d/%d)\n", timeout, attempt, REQ_RETRIES);
+        conn_open(c);
+        
+        timeout *= 2;
+        if (timeout > REQ_TIMEOUT_MAX) {
+            timeout = REQ_TIMEOUT_MAX;
+        }
+    }
+    
+    printf("Сервер недоступен\n");
+    return -1;
 }
 
 // Отображает правила игры: механика быков и коров, последовательность действия, примеры
-void show_rules() {
+// Параметры: len - длина слова в игре
+void show_rules(int len) {
     printf("\n==============================\n");
     printf("   ИГРА: УГАДАЙ СЛОВО\n");
     printf("==============================\n");
-    printf("Цель: угадать 5-буквенное слово\n\n");
+    printf("Цель: угадать %d-буквенное слово\n\n", len);
     printf("БЫК  - буква и позиция угаданы верно\n");
     printf("КОРОВА - буква верна, позиция нет\n\n");
-    printf("Пример:\n");
+    printf("Пример (5 букв):\n");
     printf("  Секрет: house\n");
     printf("  Попытка: heart -> 1 бык, 1 корова\n");
     printf("  Попытка: horse -> 4 быка, 0 коров\n");
@@ -34,10 +164,10 @@ void show_rules() {
     printf("==============================\n\n");
 }
 
-// Читает 5-буквенное слово у пользователя (любые буквы a-z)
-// Параметры: w - буфер для сохранения
+// Читает слово длины len у пользователя (любые буквы a-z)
+// Параметры: w - буфер для сохранения, len - длина слова в игре
 // На "quit" возвращаем -1, иначе 0 при ошибке, 1 при успехе
-int get_word(char *w) {
+int get_word(char *w, int len) {
     char buf[100];
     printf("Введите слово (или 'quit' для выхода): ");
     
@@ -56,12 +186,12 @@ int get_word(char *w) {
     }
     
     // Проверяем только длину и буквы (не проверяем наличие в словаре)
-    if (strlen(buf) != WORD_LENGTH) {
-        printf("Слово должно быть ровно %d букв\n", WORD_LENGTH);
+    if (strlen(buf) != (size_t)len) {
+        printf("Слово должно быть ровно %d букв\n", len);
         return 0;
     }
     
-    for (int i = 0; i < WORD_LENGTH; i++) {
+    for (int i = 0; i < len; i++) {
         if (buf[i] < 'a' || buf[i] > 'z') {
             printf("Используйте только буквы a-z\n");
             return 0;
@@ -73,9 +203,9 @@ int get_word(char *w) {
 }
 
 // Интерактивный диалог создания новой игры
-// Параметры: s - сокет DEALER, u - имя пользователя
+// Параметры: c - соединение, u - имя пользователя
 // Отправляем MSG_NEW_GAME серверу
-void make_game(void *s, const char *u) {
+void make_game(Conn *c, const char *u) {
     Msg r, p;
     msg_create(&r);
     
@@ -102,11 +232,23 @@ void make_game(void *s, const char *u) {
         return;
     }
     
-    printf("Отправка...\n");
-    send_msg(s, &r);
+    printf("Длина слова (%d-%d): ", MIN_WORD_LENGTH, MAX_WORD_LENGTH);
+    if (scanf("%d", &r.word_len) != 1) {
+        printf("Ошибка ввода\n");
+        while (getchar() != '\n');
+        return;
+    }
+    while (getchar() != '\n'); // Очистка буфера
     
-    printf("Ожидание...\n");
-    recv_msg(s, &p);
+    if (dict_get(r.word_len) == NULL) {
+        printf("Некорректная длина слова\n");
+        return;
+    }
+    
+    printf("Отправка...\n");
+    if (request(c, &r, &p) != 0) {
+        return;
+    }
     
     if (p.cmd == MSG_FAIL) {
         printf("Ошибка: %s\n", p.msg);
@@ -114,16 +256,16 @@ void make_game(void *s, const char *u) {
     }
     
     printf("\nИгра '%s' создана!\n", p.game_id);
-    printf("Игроков: %d\n", p.player_cnt);
+    printf("Игроков: %d, букв в слове: %d\n", p.player_cnt, p.word_len);
     printf("[DEBUG] Секрет: %s\n", p.word);
     
-    game_play(s, u, p.game_id);
+    game_play(c, u, p.game_id, p.word_len);
 }
 
 // Присоединение к существующей игре по её имени
-// Параметры: s - сокет DEALER, u - имя пользователя
+// Параметры: c - соединение, u - имя пользователя
 // Отправляем MSG_JOIN_BY_ID серверу
-void join_game(void *s, const char *u) {
+void join_game(Conn *c, const char *u) {
     Msg r, p;
     msg_create(&r);
     
@@ -137,8 +279,9 @@ void join_game(void *s, const char *u) {
     }
     r.game_id[strcspn(r.game_id, "\n")] = 0;
     
-    send_msg(s, &r);
-    recv_msg(s, &p);
+    if (request(c, &r, &p) != 0) {
+        return;
+    }
     
     if (p.cmd == MSG_FAIL) {
         printf("Ошибка: %s\n", p.msg);
@@ -146,31 +289,72 @@ void join_game(void *s, const char *u) {
     }
     
     printf("\nВы в игре '%s'!\n", p.game_id);
-    printf("Игроков: %d\n", p.player_cnt);
+    printf("Игроков: %d, букв в слове: %d\n", p.player_cnt, p.word_len);
     printf("[DEBUG] Секрет: %s\n", p.word);
     
-    game_play(s, u, p.game_id);
+    game_play(c, u, p.game_id, p.word_len);
+}
+
+// Быстрая игра: сервер сам подбирает игру с нужной длиной слова или создаёт новую
+// Параметры: c - соединение, u - имя пользователя
+// Отправляем MSG_QUICK_JOIN серверу
+void quick_join(Conn *c, const char *u) {
+    Msg r, p;
+    msg_create(&r);
+    
+    r.cmd = MSG_QUICK_JOIN;
+    strcpy(r.user_name, u);
+    
+    printf("Длина слова (%d-%d): ", MIN_WORD_LENGTH, MAX_WORD_LENGTH);
+    if (scanf("%d", &r.word_len) != 1) {
+        printf("Ошибка ввода\n");
+        while (getchar() != '\n');
+        return;
+    }
+    while (getchar() != '\n'); // Очистка буфера
+    
+    if (dict_get(r.word_len) == NULL) {
+        printf("Некорректная длина слова\n");
+        return;
+    }
+    
+    printf("Поиск игры...\n");
+    if (request(c, &r, &p) != 0) {
+        return;
+    }
+    
+    if (p.cmd == MSG_FAIL) {
+        printf("Ошибка: %s\n", p.msg);
+        return;
+    }
+    
+    printf("\nВы в игре '%s'!\n", p.game_id);
+    printf("Игроков: %d, букв в слове: %d\n", p.player_cnt, p.word_len);
+    printf("[DEBUG] Секрет: %s\n", p.word);
+    
+    game_play(c, u, p.game_id, p.word_len);
 }
 
 // Показывает кол-во активных игр на сервере
-// Параметры: s - сокет DEALER
-void list_games(void *s) {
+// Параметры: c - соединение
+void list_games(Conn *c) {
     Msg r, p;
     msg_create(&r);
     
     r.cmd = MSG_GET_GAMES;
     
-    send_msg(s, &r);
-    recv_msg(s, &p);
+    if (request(c, &r, &p) != 0) {
+        return;
+    }
     
     printf("\nАктивных игр: %d\n", p.total_games);
 }
 
 // Основной игровой цикл
-// Параметры: s - сокет, u - имя, g - имя игры
+// Параметры: c - соединение, u - имя, g - имя игры, len - длина слова
 // Логика: цикл ввода слов - отправка - получение быков/коров - проверка победы
-void game_play(void *s, const char *u, const char *g) {
-    show_rules();
+void game_play(Conn *c, const char *u, const char *g, int len) {
+    show_rules(len);
     
     printf("Начинаем игру!\n");
     printf("Введите 'quit' чтобы выйти\n\n");
@@ -186,7 +370,7 @@ void game_play(void *s, const char *u, const char *g) {
         strcpy(r.user_name, u);
         strcpy(r.game_id, g);
         
-        int gw = get_word(r.word);
+        int gw = get_word(r.word, len);
         if (gw == -1) {
             break; // игрок решил выйти
         }
@@ -195,8 +379,9 @@ void game_play(void *s, const char *u, const char *g) {
             continue;
         }
         
-        send_msg(s, &r);
-        recv_msg(s, &p);
+        if (request(c, &r, &p) != 0) {
+            break;
+        }
         
         if (p.cmd == MSG_FAIL) {
             printf("Ошибка: %s\n", p.msg);
@@ -227,8 +412,18 @@ void game_play(void *s, const char *u, const char *g) {
     quit_r.cmd = MSG_QUIT_GAME;
     strcpy(quit_r.user_name, u);
     strcpy(quit_r.game_id, g);
-    send_msg(s, &quit_r);
-    recv_msg(s, &quit_p);
+    request(c, &quit_r, &quit_p);
+}
+
+// Применяет настройку клиента из конфигурационного файла
+// Поддерживается ключ server - адрес сервера (tcp://, ipc://)
+// Возвращает: 0 при успехе, -1 при неизвестном ключе
+int set_opt(const char *key, const char *val) {
+    if (strcmp(key, "server") == 0) {
+        snprintf(serv_addr, sizeof(serv_addr), "%s", val);
+        return 0;
+    }
+    return -1;
 }
 
 // Отображает главное меню доступных действий
@@ -238,16 +433,35 @@ void menu() {
     printf("==============================\n");
     printf("1. Создать игру\n");
     printf("2. Присоединиться к игре\n");
-    printf("3. Список игр\n");
-    printf("4. Выход\n");
+    printf("3. Быстрая игра\n");
+    printf("4. Список игр\n");
+    printf("5. Выход\n");
     printf("==============================\n");
     printf("Выберите: ");
 }
 
 // Точка входа клиента: инициализация ZeroMQ DEALER сокета, подключение к серверу, основной цикл меню
 // Пользователь может создавать/присоединяться к играм, просматривать активные игры, играть
-int main() {
+// Адрес сервера: -a адрес или ключ server в файле -c
+int main(int argc, char **argv) {
     char user_name[MAX_USERNAME];
+    int opt;
+    
+    while ((opt = getopt(argc, argv, "a:c:")) != -1) {
+        switch (opt) {
+            case 'a':
+                set_opt("server", optarg);
+                break;
+            case 'c':
+                if (conf_load(optarg, set_opt) != 0) {
+                    return 1;
+                }
+                break;
+            default:
+                printf("Использование: %s [-a адрес сервера] [-c файл]\n", argv[0]);
+                return 1;
+        }
+    }
     
     printf("==============================\n");
     printf("  КЛИЕНТ: БЫКИ И КОРОВЫ\n");
@@ -269,10 +483,11 @@ int main() {
     printf("Добро пожаловать, %s!\n", user_name);
     printf("Подключение...\n");
     
-    void *ctx = zmq_ctx_new();
-    void *sock = zmq_socket(ctx, ZMQ_DEALER);
+    // Номера запросов начинаются со случайного места: сервер помнит req_id по логину,
+    // и повторный запуск клиента с тем же именем не должен попасть в старые номера
+    Conn conn = {zmq_ctx_new(), NULL, serv_addr, (uint32_t)time(NULL) ^ (uint32_t)getpid() << 16};
     
-    int rc = zmq_connect(sock, SERV);
+    int rc = conn_open(&conn);
     if (rc != 0) {
         printf("Ошибка подключения\n");
         return 1;
@@ -293,18 +508,21 @@ int main() {
         
         switch (choice) {
             case 1:
-                make_game(sock, user_name);
+                make_game(&conn, user_name);
                 break;
             case 2:
-                join_game(sock, user_name);
+                join_game(&conn, user_name);
                 break;
             case 3:
-                list_games(sock);
+                quick_join(&conn, user_name);
                 break;
             case 4:
+                list_games(&conn);
+                break;
+            case 5:
                 printf("До свидания!\n");
-                zmq_close(sock);
-                zmq_ctx_destroy(ctx);
+                zmq_close(conn.sock);
+                zmq_ctx_destroy(conn.ctx);
                 return 0;
             default:
                 printf("Неверный выбор\n");
@@ -0,0 +1,456 @@
+#include "colfile.h"
+#include "intern.h"
+
+// Формат файла - последовательность самостоятельных блоков:
+//   u32 COL_MAGIC, u32 длина остатка блока, u32 игр, u32 игроков, u32 столбцов,
+//   затем столбцы: u8 номер, u8 кодирование, u32 длина, данные.
+// Числа u32 записаны little-endian. Каждый блок несёт свои словари,
+// поэтому недописанный последний блок (сбой процесса) просто отбрасывается
+
+// Растущий буфер байт
+typedef struct {
+    uint8_t *p;
+    size_t len;
+    size_t cap;
+    int err;
+} Buf;
+
+static void buf_reserve(Buf *b, size_t n) {
+    if (b->err || b->len + n <= b->cap) {
+        return;
+    }
+    size_t cap = b->cap ? b->cap * 2 : 4096;
+    while (cap < b->len + n) {
+        cap *= 2;
+    }
+    uint8_t *tmp = realloc(b->p, cap);
+    if (tmp == NULL) {
+        b->err = 1;
+        return;
+    }
+    b->p = tmp;
+    b->cap = cap;
+}
+
+static void buf_put(Buf *b, const void *p, size_t n) {
+    buf_reserve(b, n);
+    if (!b->err) {
+        memcpy(b->p + b->len, p, n);
+        b->len += n;
+    }
+}
+
+static void put_u32(Buf *b, uint32_t v) {
+    uint8_t c[4] = {(uint8_t)v, (uint8_t)(v >> 8), (uint8_t)(v >> 16), (uint8_t)(v >> 24)};
+    buf_put(b, c, 4);
+}
+
+static void put_varint(Buf *b, uint32_t v) {
+    uint8_t c[5];
+    int n = 0;
+    while (v >= 0x80) {
+        c[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    c[n++] = (uint8_t)v;
+    buf_put(b, c, (size_t)n);
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+// Читает varint из [*p, e)
+// Возвращает: 0 при успехе, -1 если данные кончились
+static int get_varint(const uint8_t **p, const uint8_t *e, uint32_t *v) {
+    uint32_t x = 0;
+    for (int shift = 0; shift < 35 && *p < e; shift += 7) {
+        uint8_t c = *(*p)++;
+        x |= (uint32_t)(c & 0x7f) << shift;
+        if (!(c & 0x80)) {
+            *v = x;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// Кодирует числа: серии (RLE) или varint - что короче; с delta - разности соседних
+// Параметры: out - куда дописать, enc - куда записать выбранное кодирование, v, n - числа
+static void put_ints(Buf *out, uint8_t *enc, const uint32_t *v, uint32_t n, int delta) {
+    if (delta) {
+        uint32_t prev = 0;
+        for (uint32_t i = 0; i < n; i++) {
+            uint32_t d = v[i] - prev;
+            put_varint(out, (d << 1) ^ (0u - (d >> 31)));
+            prev = v[i];
+        }
+        *enc = ENC_DELTA;
+        return;
+    }
+
+    Buf rle = {0};
+    size_t plain = 0;
+    for (uint32_t i = 0; i < n; ) {
+        uint32_t j = i;
+        while (j < n && v[j] == v[i]) {
+            j++;
+        }
+        put_varint(&rle, v[i]);
+        put_varint(&rle, j - i);
+        i = j;
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        plain += v[i] < 1u << 7 ? 1 : v[i] < 1u << 14 ? 2 : v[i] < 1u << 21 ? 3 : v[i] < 1u << 28 ? 4 : 5;
+    }
+
+    if (!rle.err && rle.len < plain) {
+        buf_put(out, rle.p, rle.len);
+        *enc = ENC_RLE;
+    } else {
+        for (uint32_t i = 0; i < n; i++) {
+            put_varint(out, v[i]);
+        }
+        *enc = ENC_VARINT;
+    }
+    free(rle.p);
+}
+
+// Декодирует числа, записанные put_ints
+// Возвращает: 0 при успехе, -1 при повреждённых данных
+static int get_ints(const uint8_t *p, const uint8_t *e, int enc, uint32_t *v, uint32_t n) {
+    uint32_t x, run, prev = 0;
+
+    for (uint32_t i = 0; i < n; ) {
+        if (get_varint(&p, e, &x) != 0) {
+            return -1;
+        }
+        switch (enc) {
+            case ENC_VARINT:
+                v[i++] = x;
+                break;
+            case ENC_DELTA:
+                prev += (x >> 1) ^ (0u - (x & 1));
+                v[i++] = prev;
+                break;
+            case ENC_RLE:
+                if (get_varint(&p, e, &run) != 0 || run > n - i) {
+                    return -1;
+                }
+                while (run-- > 0) {
+                    v[i++] = x;
+                }
+                break;
+            default:
+                return -1;
+        }
+    }
+    return 0;
+}
+
+// Начинает столбец; длина дописывается в col_end
+static size_t col_begin(Buf *b, int id) {
+    uint8_t h[2] = {(uint8_t)id, 0};
+    buf_put(b, h, 2);
+    put_u32(b, 0);
+    return b->len;
+}
+
+static void col_end(Buf *b, size_t start, uint8_t enc) {
+    if (b->err) {
+        return;
+    }
+    uint32_t len = (uint32_t)(b->len - start);
+    b->p[start - 5] = enc;
+    uint8_t c[4] = {(uint8_t)len, (uint8_t)(len >> 8), (uint8_t)(len >> 16), (uint8_t)(len >> 24)};
+    memcpy(b->p + start - 4, c, 4);
+}
+
+static void put_int_col(Buf *b, int id, const uint32_t *v, uint32_t n, int delta) {
+    uint8_t enc;
+    size_t start = col_begin(b, id);
+    put_ints(b, &enc, v, n, delta);
+    col_end(b, start, enc);
+}
+
+// Кодирует строковый столбец словарём: каждая различная строка пишется один раз,
+// дальше идут номера строк (RLE или varint)
+// Возвращает: 0 при успехе, -1 при нехватке памяти
+static int put_str_col(Buf *b, int id, const char **s, uint32_t n) {
+    uint32_t cap = 16;
+    while (cap < n * 2) {
+        cap *= 2;
+    }
+
+    uint32_t *slot = malloc(cap * sizeof(uint32_t));     // номер в словаре + 1, 0 - пусто
+    uint32_t *words = malloc((n + 1) * sizeof(uint32_t)); // позиция первой встречи строки
+    uint32_t *idx = malloc((n + 1) * sizeof(uint32_t));
+    if (slot == NULL || words == NULL || idx == NULL) {
+        free(slot);
+        free(words);
+        free(idx);
+        return -1;
+    }
+    memset(slot, 0, cap * sizeof(uint32_t));
+
+    uint32_t cnt = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t k = str_hash(s[i]) & (cap - 1);
+        while (slot[k] != 0 && strcmp(s[words[slot[k] - 1]], s[i]) != 0) {
+            k = (k + 1) & (cap - 1);
+        }
+        if (slot[k] == 0) {
+            words[cnt++] = i;
+            slot[k] = cnt;
+        }
+        idx[i] = slot[k] - 1;
+    }
+
+    size_t start = col_begin(b, id);
+    put_varint(b, cnt);
+    for (uint32_t i = 0; i < cnt; i++) {
+        uint32_t len = (uint32_t)strlen(s[words[i]]);
+        put_varint(b, len);
+        buf_put(b, s[words[i]], len);
+    }
+
+    uint8_t enc;
+    size_t enc_at = b->len;
+    buf_put(b, "", 1);
+    put_ints(b, &enc, idx, n, 0);
+    if (!b->err) {
+        b->p[enc_at] = enc;
+    }
+    col_end(b, start, ENC_DICT);
+
+    free(slot);
+    free(words);
+    free(idx);
+    return 0;
+}
+
+// Записывает игры одним блоком и сбрасывает его в файл
+// Параметры: f - файл сегмента, recs - игры, n - их число
+// Возвращает: размер блока в байтах или -1 при ошибке
+long col_write_block(FILE *f, const GameRec *recs, int n) {
+    if (n <= 0) {
+        return 0;
+    }
+
+    uint32_t rows = (uint32_t)n, prows = 0;
+    for (int i = 0; i < n; i++) {
+        prows += recs[i].players;
+    }
+
+    uint32_t *ints = malloc(((size_t)rows + prows + 1) * sizeof(uint32_t));
+    const char **strs = malloc(((size_t)rows + prows + 1) * sizeof(char *));
+    Buf b = {0};
+    if (ints == NULL || strs == NULL) {
+        free(ints);
+        free(strs);
+        return -1;
+    }
+
+    put_u32(&b, COL_MAGIC);
+    put_u32(&b, 0);
+    put_u32(&b, rows);
+    put_u32(&b, prows);
+    put_u32(&b, COL_COUNT - 1);
+
+#define GAME_COL(id, expr, delta) do { \
+        for (int i = 0; i < n; i++) ints[i] = (expr); \
+        put_int_col(&b, id, ints, rows, delta); \
+    } while (0)
+
+    GAME_COL(COL_END, recs[i].end, 1);
+    GAME_COL(COL_WORD_LEN, recs[i].word_len, 0);
+    GAME_COL(COL_SLOTS, recs[i].slots, 0);
+    GAME_COL(COL_PLAYERS, recs[i].players, 0);
+    GAME_COL(COL_WON, recs[i].won, 0);
+
+#undef GAME_COL
+
+    int rc = 0;
+    for (int i = 0; i < n; i++) {
+        strs[i] = recs[i].title;
+    }
+    rc |= put_str_col(&b, COL_TITLE, strs, rows);
+    for (int i = 0; i < n; i++) {
+        strs[i] = recs[i].secret;
+    }
+    rc |= put_str_col(&b, COL_SECRET, strs, rows);
+
+    uint32_t k = 0;
+    for (int i = 0; i < n; i++) {
+        for (int u = 0; u < recs[i].players; u++, k++) {
+            strs[k] = recs[i].login[u];
+            ints[k] = recs[i].tries[u];
+        }
+    }
+    rc |= put_str_col(&b, COL_LOGIN, strs, prows);
+    put_int_col(&b, COL_TRIES, ints, prows, 0);
+
+    long total = -1;
+    if (rc == 0 && !b.err) {
+        uint32_t len = (uint32_t)(b.len - 8);
+        uint8_t c[4] = {(uint8_t)len, (uint8_t)(len >> 8), (uint8_t)(len >> 16), (uint8_t)(len >> 24)};
+        memcpy(b.p + 4, c, 4);
+        if (fwrite(b.p, 1, b.len, f) == b.len && fflush(f) == 0) {
+            total = (long)b.len;
+        }
+    }
+
+    free(b.p);
+    free(ints);
+    free(strs);
+    return total;
+}
+
+// Выделяет (или переиспользует) память блока
+static int grow(void **p, size_t *cap, size_t need) {
+    if (need <= *cap) {
+        return 0;
+    }
+    void *tmp = realloc(*p, need);
+    if (tmp == NULL) {
+        return -1;
+    }
+    *p = tmp;
+    *cap = need;
+    return 0;
+}
+
+// Разбирает строковый столбец: словарь в arena/ptrs, номера в s->idx
+static int get_str_col(ColBlock *b, const uint8_t *p, const uint8_t *e, ColStrings *s, uint32_t n,
+        size_t *arena_used, size_t *ptrs_used) {
+    if (get_varint(&p, e, &s->cnt) != 0 || s->cnt > (size_t)(e - p)) {
+        return -1;
+    }
+
+    s->words = b->ptrs + *ptrs_used;
+    *ptrs_used += s->cnt;
+
+    for (uint32_t i = 0; i < s->cnt; i++) {
+        uint32_t len;
+        if (get_varint(&p, e, &len) != 0 || len > (size_t)(e - p)) {
+            return -1;
+        }
+        char *w = b->arena + *arena_used;
+        memcpy(w, p, len);
+        w[len] = 0;
+        *arena_used += len + 1;
+        s->words[i] = w;
+        p += len;
+    }
+
+    if (p == e) {
+        return n == 0 ? 0 : -1;
+    }
+    int enc = *p++;
+    if (get_ints(p, e, enc, s->idx, n) != 0) {
+        return -1;
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        if (s->idx[i] >= s->cnt) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Читает следующий блок файла; память блока переиспользуется между вызовами.
+// Разбираются только запрошенные столбцы, остальные пропускаются по длине (остаются нулями)
+// Параметры: f - файл сегмента, b - блок (обнулённый перед первым вызовом), want - маска COL_BIT
+// Возвращает: 1 - блок прочитан, 0 - конец файла (или недописанный блок), -1 - повреждённые данные
+int col_read_block(FILE *f, ColBlock *b, uint32_t want) {
+    uint8_t h[8];
+    if (fread(h, 1, 8, f) != 8) {
+        return 0;
+    }
+    if (get_u32(h) != COL_MAGIC) {
+        return -1;
+    }
+
+    size_t len = get_u32(h + 4);
+    if (len < 12 || grow((void **)&b->raw, &b->raw_cap, len) != 0) {
+        return -1;
+    }
+    if (fread(b->raw, 1, len, f) != len) {
+        return 0;
+    }
+
+    const uint8_t *p = b->raw, *e = b->raw + len;
+    b->rows = get_u32(p);
+    b->prows = get_u32(p + 4);
+    uint32_t cols = get_u32(p + 8);
+    p += 12;
+
+    // Номера строк занимают не меньше байта, поэтому строк в блоке не больше len
+    if (b->rows > len || b->prows > len) {
+        return -1;
+    }
+    size_t ints = (size_t)b->rows * 7 + (size_t)b->prows * 2;
+    if (grow((void **)&b->ints, &b->ints_cap, ints * sizeof(uint32_t)) != 0 ||
+        grow((void **)&b->arena, &b->arena_cap, len * 2) != 0 ||
+        grow((void **)&b->ptrs, &b->ptrs_cap, len * sizeof(char *)) != 0) {
+        return -1;
+    }
+    memset(b->ints, 0, ints * sizeof(uint32_t));
+
+    uint32_t *v = b->ints;
+    b->end = v; v += b->rows;
+    b->word_len = v; v += b->rows;
+    b->slots = v; v += b->rows;
+    b->players = v; v += b->rows;
+    b->won = v; v += b->rows;
+    b->title.idx = v; v += b->rows;
+    b->secret.idx = v; v += b->rows;
+    b->login.idx = v; v += b->prows;
+    b->tries = v;
+
+    b->title.cnt = b->secret.cnt = b->login.cnt = 0;
+    size_t arena_used = 0, ptrs_used = 0;
+
+    for (uint32_t c = 0; c < cols; c++) {
+        if (e - p < 6) {
+            return -1;
+        }
+        int id = p[0], enc = p[1];
+        size_t clen = get_u32(p + 2);
+        p += 6;
+        if (clen > (size_t)(e - p)) {
+            return -1;
+        }
+        const uint8_t *ce = p + clen;
+
+        // Столбцы, которых нет в COL_*, пропускаются (COL_BIT определён только для них)
+        int rc = 0;
+        switch (id < COL_COUNT && (want & COL_BIT(id)) ? id : 0) {
+            case COL_END: rc = get_ints(p, ce, enc, b->end, b->rows); break;
+            case COL_WORD_LEN: rc = get_ints(p, ce, enc, b->word_len, b->rows); break;
+            case COL_SLOTS: rc = get_ints(p, ce, enc, b->slots, b->rows); break;
+            case COL_PLAYERS: rc = get_ints(p, ce, enc, b->players, b->rows); break;
+            case COL_WON: rc = get_ints(p, ce, enc, b->won, b->rows); break;
+            case COL_TRIES: rc = get_ints(p, ce, enc, b->tries, b->prows); break;
+            case COL_TITLE: rc = get_str_col(b, p, ce, &b->title, b->rows, &arena_used, &ptrs_used); break;
+            case COL_SECRET: rc = get_str_col(b, p, ce, &b->secret, b->rows, &arena_used, &ptrs_used); break;
+            case COL_LOGIN: rc = get_str_col(b, p, ce, &b->login, b->prows, &arena_used, &ptrs_used); break;
+            default: break;
+        }
+        if (rc != 0) {
+            return -1;
+        }
+        p = ce;
+    }
+
+    return 1;
+}
+
+// Освобождает память прочитанного блока
+void col_block_free(ColBlock *b) {
+    free(b->raw);
+    free(b->arena);
+    free(b->ints);
+    free(b->ptrs);
+    memset(b, 0, sizeof(ColBlock));
+}
@@ -0,0 +1,84 @@
+#ifndef COLFILE_H
+#define COLFILE_H
+
+#include "func.h"
+
+#define COL_MAGIC 0x31424347u       // "GCB1"
+
+// Столбцы блока; читатель пропускает неизвестные номера
+typedef enum {
+    COL_END = 1,        // время окончания игры (секунды), по играм
+    COL_WORD_LEN,       // длина слова, по играм
+    COL_SLOTS,          // мест в игре, по играм
+    COL_PLAYERS,        // игроков в игре, по играм
+    COL_WON,            // бит i - игрок i угадал слово, по играм
+    COL_TITLE,          // название игры, по играм
+    COL_SECRET,         // загаданное слово, по играм
+    COL_LOGIN,          // логин, по игрокам всех игр подряд
+    COL_TRIES,          // попыток игрока, по игрокам
+    COL_COUNT
+} ColId;
+
+#define COL_BIT(id) (1u << (id))    // только для id < COL_COUNT
+#define COL_ALL 0xffffffffu
+
+// Кодирование столбца
+typedef enum {
+    ENC_VARINT = 1,     // числа в varint
+    ENC_RLE,            // пары (значение, длина серии) в varint
+    ENC_DELTA,          // разности соседних значений (zigzag varint)
+    ENC_DICT,           // словарь строк блока + номера строк в varint
+} ColEnc;
+
+// Законченная игра - запись для выгрузки.
+// Строки title и login не копируются: это строки пула интернирования, они живут до store_free
+typedef struct {
+    uint32_t end;
+    uint8_t word_len;
+    uint8_t slots;
+    uint8_t players;
+    uint16_t won;
+    const char *title;
+    char secret[MAX_WORD_LENGTH + 1];
+    const char *login[MAX_GAME_PLAYERS];
+    uint16_t tries[MAX_GAME_PLAYERS];
+} GameRec;
+
+// Строковый столбец после чтения: словарь и номера строк
+typedef struct {
+    uint32_t cnt;
+    char **words;
+    uint32_t *idx;
+} ColStrings;
+
+// Прочитанный блок: столбцы как массивы.
+// Столбцы по играм имеют длину rows, по игрокам - длину prows
+typedef struct {
+    uint32_t rows;
+    uint32_t prows;
+    uint32_t *end;
+    uint32_t *word_len;
+    uint32_t *slots;
+    uint32_t *players;
+    uint32_t *won;
+    uint32_t *tries;
+    ColStrings title;
+    ColStrings secret;
+    ColStrings login;
+
+    // Память под всё перечисленное
+    uint8_t *raw;
+    size_t raw_cap;
+    char *arena;
+    size_t arena_cap;
+    uint32_t *ints;
+    size_t ints_cap;
+    char **ptrs;
+    size_t ptrs_cap;
+} ColBlock;
+
+long col_write_block(FILE *f, const GameRec *recs, int n);
+int col_read_block(FILE *f, ColBlock *b, uint32_t want);
+void col_block_free(ColBlock *b);
+
+#endif
@@ -0,0 +1,183 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "export.h"
+
+#include <unistd.h>
+#include <pthread.h>
+
+static pthread_mutex_t exp_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t exp_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t exp_thread;
+static int exp_on = 0;
+static int exp_stop = 0;
+
+// Буфер, который наполняет export_push (под exp_lock)
+static GameRec *pending = NULL;
+static int pending_cnt = 0;
+static int pending_cap = 0;
+static long dropped = 0;
+
+// Состояние писателя (только фоновый поток)
+static char exp_dir[256];
+static FILE *seg = NULL;
+static int seg_no = 0;
+static long seg_games = 0;
+
+static long games_total = 0;
+static long bytes_total = 0;
+
+// Открывает новый сегмент
+// Возвращает: 0 при успехе, -1 при ошибке
+static int seg_open() {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/games-%ld-%d-%04d.col",
+        exp_dir, (long)time(NULL), (int)getpid(), ++seg_no);
+
+    seg = fopen(path, "wb");
+    if (seg == NULL) {
+        printf("Выгрузка: не удалось открыть %s\n", path);
+        return -1;
+    }
+    seg_games = 0;
+    return 0;
+}
+
+// Пишет игры блоком, при заполнении сегмента начинает следующий
+static void write_games(const GameRec *recs, int n) {
+    if (seg == NULL && seg_open() != 0) {
+        return;
+    }
+
+    long bytes = col_write_block(seg, recs, n);
+    if (bytes < 0) {
+        printf("Выгрузка: ошибка записи, потеряно игр: %d\n", n);
+        return;
+    }
+
+    games_total += n;
+    bytes_total += bytes;
+    seg_games += n;
+
+    if (seg_games >= EXPORT_SEG_GAMES) {
+        fclose(seg);
+        seg = NULL;
+    }
+}
+
+// Фоновый поток: забирает накопленные игры и пишет их блоками
+static void* export_thread(void *arg) {
+    (void)arg;
+    GameRec *batch = NULL;
+    int batch_cap = 0;
+
+    pthread_mutex_lock(&exp_lock);
+    while (1) {
+        if (pending_cnt < EXPORT_BATCH && !exp_stop) {
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            ts.tv_sec += EXPORT_FLUSH_MS / 1000;
+            pthread_cond_timedwait(&exp_cond, &exp_lock, &ts);
+        }
+
+        if (pending_cnt == 0) {
+            if (exp_stop) {
+                break;
+            }
+            continue;
+        }
+
+        // Меняемся буферами: export_push продолжает писать в пустой
+        GameRec *full = pending;
+        int full_cap = pending_cap;
+        int n = pending_cnt;
+        pending = batch;
+        pending_cap = batch_cap;
+        pending_cnt = 0;
+        pthread_mutex_unlock(&exp_lock);
+
+        for (int i = 0; i < n; i += EXPORT_BATCH) {
+            write_games(full + i, n - i < EXPORT_BATCH ? n - i : EXPORT_BATCH);
+        }
+        batch = full;
+        batch_cap = full_cap;
+
+        pthread_mutex_lock(&exp_lock);
+    }
+    pthread_mutex_unlock(&exp_lock);
+
+    free(batch);
+    return NULL;
+}
+
+// Запускает фоновую выгрузку в каталог dir
+// Возвращает: 0 при успехе, -1 при ошибке
+int export_start(const char *dir) {
+    snprintf(exp_dir, sizeof(exp_dir), "%s", dir);
+    if (access(exp_dir, W_OK) != 0) {
+        printf("Выгрузка: каталог %s недоступен для записи\n", exp_dir);
+        return -1;
+    }
+
+    exp_stop = 0;
+    if (pthread_create(&exp_thread, NULL, export_thread, NULL) != 0) {
+        return -1;
+    }
+    exp_on = 1;
+    return 0;
+}
+
+// Ставит законченную игру в очередь на выгрузку (копия записи, без ввода-вывода)
+// Параметры: r - запись игры
+void export_push(const GameRec *r) {
+    if (!exp_on) {
+        return;
+    }
+
+    pthread_mutex_lock(&exp_lock);
+
+    if (pending_cnt == pending_cap) {
+        int cap = pending_cap ? pending_cap * 2 : EXPORT_BATCH;
+        GameRec *tmp = cap <= EXPORT_MAX_PENDING ? realloc(pending, (size_t)cap * sizeof(GameRec)) : NULL;
+        if (tmp == NULL) {
+            dropped++;
+            pthread_mutex_unlock(&exp_lock);
+            return;
+        }
+        pending = tmp;
+        pending_cap = cap;
+    }
+
+    pending[pending_cnt++] = *r;
+    if (pending_cnt == EXPORT_BATCH) {
+        pthread_cond_signal(&exp_cond);
+    }
+
+    pthread_mutex_unlock(&exp_lock);
+}
+
+// Дописывает всё накопленное, закрывает сегмент и останавливает поток
+void export_stop(void) {
+    if (!exp_on) {
+        return;
+    }
+
+    pthread_mutex_lock(&exp_lock);
+    exp_stop = 1;
+    pthread_cond_signal(&exp_cond);
+    pthread_mutex_unlock(&exp_lock);
+
+    pthread_join(exp_thread, NULL);
+    exp_on = 0;
+
+    if (seg != NULL) {
+        fclose(seg);
+        seg = NULL;
+    }
+
+    printf("Выгружено игр: %ld (%ld байт, %.1f байт/игру), отброшено: %ld\n",
+        games_total, bytes_total, games_total ? (double)bytes_total / games_total : 0.0, dropped);
+
+    free(pending);
+    pending = NULL;
+    pending_cnt = pending_cap = 0;
+}
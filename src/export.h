@@ -0,0 +1,19 @@
+#ifndef EXPORT_H
+#define EXPORT_H
+
+#include "colfile.h"
+
+#define EXPORT_BATCH 4096           // игр в блоке: набрав столько, писатель просыпается сразу
+#define EXPORT_FLUSH_MS 1000        // неполный блок пишется не реже этого
+#define EXPORT_SEG_GAMES (1 << 20)  // игр в сегменте, дальше - новый файл
+#define EXPORT_MAX_PENDING (1 << 20)  // сверх этого игры отбрасываются (диск не успевает)
+
+// Выгрузка законченных игр для аналитики.
+// export_push только копирует запись в буфер в памяти; фоновый поток
+// забирает буфер целиком и дописывает его блоком в текущий сегмент
+// <dir>/games-<время>-<pid>-<номер>.col (формат - colfile.h)
+int export_start(const char *dir);
+void export_push(const GameRec *r);
+void export_stop(void);
+
+#endif
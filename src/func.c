@@ -1,3 +1,5 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include "func.h"
 
 // Инициализирует сообщение: обнуляет всю память структуры
@@ -21,7 +23,82 @@ int msg_recv(void *sock, Msg *m) {
     return zmq_recv(sock, m, sizeof(Msg), 0);
 }
 
-const char *words_pool[] = {
+// Убирает пробелы и перевод строки в начале и конце строки (на месте)
+// Возвращает: указатель на первый значащий символ
+static char* trim(char *s) {
+    while (*s == ' ' || *s == '\t') {
+        s++;
+    }
+    
+    size_t n = strlen(s);
+    while (n > 0 && (s[n - 1] == ' ' || s[n - 1] == '\t' || s[n - 1] == '\n' || s[n - 1] == '\r')) {
+        s[--n] = 0;
+    }
+    
+    return s;
+}
+
+// Читает конфигурационный файл из строк "ключ = значение"; пустые строки и '#' пропускаются
+// Параметры: path - путь к файлу, set - обработчик пары ключ/значение (0 - принято, -1 - ошибка)
+// Возвращает: 0 при успехе, -1 если файл не открылся или в нём есть ошибка
+int conf_load(const char *path, int (*set)(const char *key, const char *val)) {
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        printf("Не удалось открыть %s\n", path);
+        return -1;
+    }
+    
+    char line[512];
+    int line_no = 0;
+    int rc = 0;
+    
+    while (fgets(line, sizeof(line), f) != NULL) {
+        line_no++;
+        
+        char *s = trim(line);
+        if (*s == 0 || *s == '#') {
+            continue;
+        }
+        
+        char *eq = strchr(s, '=');
+        if (eq == NULL) {
+            printf("%s:%d: ожидается 'ключ = значение'\n", path, line_no);
+            rc = -1;
+            break;
+        }
+        
+        *eq = 0;
+        if (set(trim(s), trim(eq + 1)) != 0) {
+            printf("%s:%d: неизвестный ключ или неверное значение\n", path, line_no);
+            rc = -1;
+            break;
+        }
+    }
+    
+    fclose(f);
+    return rc;
+}
+
+// Текущее монотонное время в микросекундах
+uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+// Словари по длине слова
+static const char *words4[] = {
+    "area", "bank", "bird", "boat", "book",
+    "cake", "card", "city", "coin", "door",
+    "duck", "fire", "fish", "frog", "gift",
+    "gold", "hand", "hill", "king", "lake",
+    "leaf", "lion", "moon", "nest", "note",
+    "park", "rain", "ring", "road", "rock",
+    "rose", "salt", "ship", "snow", "star",
+    "tree", "wind", "wolf", "wood", "yard"
+};
+
+static const char *words5[] = {
     "house", "plant", "water", "music", "stone",
     "bread", "beach", "cloud", "dream", "earth",
     "field", "flame", "frost", "glass", "happy",
@@ -32,59 +109,147 @@ const char *words_pool[] = {
     "delta", "eagle", "faith", "ghost", "heart"
 };
 
-// Генерирует случайное 5-буквенное слово из встроенного словаря
-// Параметры: word - буфер для результата (минимум 6 байт)
-// Использует rand() для выбора индекса из words_pool
-void gen_word(char *word) {
+static const char *words6[] = {
+    "animal", "bridge", "butter", "candle", "castle",
+    "circle", "cookie", "dinner", "doctor", "dragon",
+    "flower", "forest", "friend", "garden", "guitar",
+    "hammer", "island", "jacket", "jungle", "kitten",
+    "ladder", "letter", "market", "mirror", "monkey",
+    "number", "orange", "palace", "pencil", "planet",
+    "pocket", "rabbit", "silver", "spring", "summer",
+    "ticket", "tomato", "turtle", "window", "winter"
+};
+
+static const char *words7[] = {
+    "balloon", "blanket", "cabinet", "captain", "chicken",
+    "concert", "diamond", "dolphin", "example", "feather",
+    "freedom", "general", "history", "holiday", "kingdom",
+    "kitchen", "library", "machine", "monster", "morning",
+    "musical", "natural", "network", "officer", "package",
+    "painter", "pattern", "picture", "pyramid", "rainbow",
+    "science", "shelter", "station", "teacher", "thunder",
+    "tornado", "uniform", "village", "volcano", "weather"
+};
+
+#define DICT(w) {w, sizeof(w) / sizeof(w[0])}
+
+static const Dict dicts[MAX_WORD_LENGTH + 1] = {
+    [4] = DICT(words4),
+    [5] = DICT(words5),
+    [6] = DICT(words6),
+    [7] = DICT(words7),
+};
+
+// Возвращает словарь для длины слова
+// Параметры: len - длина слова
+// Возвращает: указатель на словарь или NULL, если такая длина не поддерживается
+const Dict* dict_get(int len) {
+    if (len < MIN_WORD_LENGTH || len > MAX_WORD_LENGTH) {
+        return NULL;
+    }
+    return &dicts[len];
+}
+
+// Генерирует случайное слово заданной длины из встроенного словаря
+// Параметры: word - буфер для результата (минимум len + 1 байт), len - длина слова
+// Использует rand() для выбора индекса из словаря этой длины
+void gen_word(char *word, int len) {
+    const Dict *d = dict_get(len);
     srand(time(NULL) ^ (unsigned int)(uintptr_t)word);
-    int idx = rand() % (sizeof(words_pool) / sizeof(words_pool[0]));
-    strcpy(word, words_pool[idx]);
+    int idx = rand() % d->cnt;
+    strcpy(word, d->words[idx]);
+}
+
+// Загружает слово длины n в младшие байты 64-битного числа (n <= 8)
+static inline uint64_t word_load(const char *w, int n) {
+    uint64_t v = 0;
+    memcpy(&v, w, n);
+    return v;
+}
+
+#define BYTES_LO 0x0101010101010101ull
+#define BYTES_HI 0x8080808080808080ull
+
+// Старший бит каждого нулевого байта v (без ложных срабатываний от переносов)
+static inline uint64_t zero_bytes(uint64_t v) {
+    uint64_t t = (v & ~BYTES_HI) + ~BYTES_HI;
+    return ~(t | v | ~BYTES_HI);
+}
+
+// Ядро подсчёта быков и коров для фиксированной длины N.
+// Слова сравниваются как 64-битные числа (SWAR), позиции - старшие биты байтов.
+// Быки: нулевые байты secret XOR guess. Коровы: для каждой небычьей буквы попытки
+// одной операцией находятся все ещё не занятые позиции секрета с этой буквой,
+// занимается младшая. Ветвлений по данным нет, поэтому нет и промахов предсказателя
+// на случайных словах; N - константа, цикл разворачивается полностью
+#define CHECK_KERNEL(N) \
+static void check_word_##N(const char *secret, const char *guess, int *bulls, int *cows) { \
+    const uint64_t full = BYTES_HI >> (8 * (8 - N)); \
+    uint64_t s = word_load(secret, N); \
+    uint64_t bull = zero_bytes(s ^ word_load(guess, N)) & full; \
+    uint64_t used = bull; \
+    int c = 0; \
+    _Pragma("GCC unroll 8") \
+    for (int i = 0; i < N; i++) { \
+        uint64_t m = zero_bytes(s ^ (BYTES_LO * (uint8_t)guess[i])) & full & ~used; \
+        m &= (bull >> (8 * i + 7) & 1) - 1; \
+        used |= m & -m; \
+        c += m != 0; \
+    } \
+    *bulls = __builtin_popcountll(bull); \
+    *cows = c; \
 }
 
+CHECK_KERNEL(4)
+CHECK_KERNEL(5)
+CHECK_KERNEL(6)
+CHECK_KERNEL(7)
+
+typedef void (*CheckKernel)(const char *secret, const char *guess, int *bulls, int *cows);
+
+static const CheckKernel check_kernels[MAX_WORD_LENGTH + 1] = {
+    [4] = check_word_4,
+    [5] = check_word_5,
+    [6] = check_word_6,
+    [7] = check_word_7,
+};
+
 // Считает быков (точное совпадение позиции) и коров (буква есть но позиция другая)
-// Параметры: secret - загаданное слово, guess - попытка, bulls - указатель на счетчик, cows - указатель на счетчик
-// Логика: быки считаются по прямому совпадению, коровы - по частотам букв минус быки
-void check_word(const char *secret, const char *guess, int *bulls, int *cows) {
-    *bulls = 0;
-    *cows = 0;
-    
-    int secret_cnt[26] = {0};
-    int guess_cnt[26] = {0};
-    
-    // Сначала подсчитываем быки и убираем эти буквы
-    for (int i = 0; i < WORD_LENGTH; i++) {
-        if (secret[i] == guess[i]) {
-            (*bulls)++;
-        } else {
-            secret_cnt[secret[i] - 'a']++;
-            guess_cnt[guess[i] - 'a']++;
-        }
-    }
-    
-    // Теперь подсчитываем коров
-    for (int i = 0; i < 26; i++) {
-        int common = secret_cnt[i] < guess_cnt[i] ? secret_cnt[i] : guess_cnt[i];
-        *cows += common;
-    }
+// Параметры: secret - загаданное слово, guess - попытка (оба длины len),
+// bulls - указатель на счетчик, cows - указатель на счетчик
+// Логика: вызывает ядро, специализированное под длину слова
+void check_word(const char *secret, const char *guess, int len, int *bulls, int *cows) {
+    check_kernels[len](secret, guess, bulls, cows);
 }
 
-// Проверяет корректность слова: длина 5, все буквы a-z, наличие в словаре
-// Параметры: word - проверяемое слово
-// Возвращает 1 если слово валидно, 0 иначе
-int word_ok(const char *word) {
-    if (strlen(word) != WORD_LENGTH) {
+// Проверяет, что слово длины len состоит только из букв a-z
+// Параметры: word - проверяемое слово, len - ожидаемая длина
+// Возвращает 1 если подходит, 0 иначе
+int word_chars_ok(const char *word, int len) {
+    if (len < MIN_WORD_LENGTH || len > MAX_WORD_LENGTH || strlen(word) != (size_t)len) {
         return 0;
     }
     
-    for (int i = 0; i < WORD_LENGTH; i++) {
+    for (int i = 0; i < len; i++) {
         if (word[i] < 'a' || word[i] > 'z') {
             return 0;
         }
     }
     
-    // Проверяем, есть ли слово в пуле
-    for (size_t i = 0; i < sizeof(words_pool) / sizeof(words_pool[0]); i++) {
-        if (strcmp(word, words_pool[i]) == 0) {
+    return 1;
+}
+
+// Проверяет корректность слова: длина len, все буквы a-z, наличие в словаре этой длины
+// Параметры: word - проверяемое слово, len - длина
+// Возвращает 1 если слово валидно, 0 иначе
+int word_ok(const char *word, int len) {
+    if (!word_chars_ok(word, len)) {
+        return 0;
+    }
+    
+    const Dict *d = dict_get(len);
+    for (int i = 0; i < d->cnt; i++) {
+        if (strcmp(word, d->words[i]) == 0) {
             return 1;
         }
     }
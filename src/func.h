@@ -11,7 +11,9 @@
 #define MAX_GAME_ID 64
 #define MAX_USERNAME 32
 #define MAX_GAME_PLAYERS 10
-#define WORD_LENGTH 5
+#define WORD_LENGTH 5        // длина слова по умолчанию
+#define MIN_WORD_LENGTH 4
+#define MAX_WORD_LENGTH 7
 #define MAX_ATTEMPTS 100
 
 // Сообщения от клиента
@@ -21,6 +23,7 @@ typedef enum {
     MSG_MAKE_TRY = 3,
     MSG_QUIT_GAME = 4,
     MSG_GET_GAMES = 5,
+    MSG_QUICK_JOIN = 6,     // войти в подходящую игру или создать новую
     
     // Ответы сервера
     MSG_GAME_OK = 10,
@@ -45,10 +48,13 @@ typedef struct {
     char game_id[MAX_GAME_ID];
     char user_name[MAX_USERNAME];
     int player_cnt;
-    char word[WORD_LENGTH + 1];
+    char word[MAX_WORD_LENGTH + 1];
+    int word_len;       // длина слова в игре: задаётся в MSG_NEW_GAME (0 - WORD_LENGTH)
     TryRes res;
     char msg[256];
     int total_games;
+    uint32_t req_id;    // номер запроса, сервер возвращает его в ответе
+    int retry_ms;       // при отказе "busy": через сколько мс повторить
 } Msg;
 
 // Функции
@@ -56,8 +62,21 @@ void msg_create(Msg *m);
 int msg_send(void *sock, Msg *m);
 int msg_recv(void *sock, Msg *m);
 
-void gen_word(char *word);
-void check_word(const char *secret, const char *guess, int *bulls, int *cows);
-int word_ok(const char *word);
+// Словарь слов одной длины
+typedef struct {
+    const char **words;
+    int cnt;
+} Dict;
+
+const Dict* dict_get(int len);
+
+int conf_load(const char *path, int (*set)(const char *key, const char *val));
+
+uint64_t now_us(void);
+
+void gen_word(char *word, int len);
+void check_word(const char *secret, const char *guess, int len, int *bulls, int *cows);
+int word_chars_ok(const char *word, int len);
+int word_ok(const char *word, int len);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,202 @@
+#include "intern.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Хэш строки FNV-1a (32 бита)
+// Параметры: s - строка
+// Возвращает: значение хэша
+uint32_t str_hash(const char *s) {
+    uint32_t h = 2166136261u;
+    while (*s) {
+        h ^= (unsigned char)*s++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Инициализирует пустой пул
+// Параметры: p - пул
+void intern_init(InternPool *p) {
+    memset(p, 0, sizeof(InternPool));
+    pthread_mutex_init(&p->lock, NULL);
+}
+
+// Освобождает всю память пула; все выданные дескрипторы становятся недействительными
+// Параметры: p - пул
+void intern_free(InternPool *p) {
+    for (int i = 0; i < INTERN_PAGES; i++) {
+        free(p->pages[i]);
+    }
+    for (int i = 0; i < p->chunk_cnt; i++) {
+        free(p->chunks[i]);
+    }
+    free(p->chunks);
+    free(p->slots);
+    free(p->hashes);
+    pthread_mutex_destroy(&p->lock);
+    memset(p, 0, sizeof(InternPool));
+}
+
+// Выделяет новый блок памяти и запоминает его для intern_free (вызывается под lock)
+// Возвращает: указатель на блок или NULL при нехватке памяти
+static char *chunk_new(InternPool *p, size_t size) {
+    if (p->chunk_cnt == p->chunk_cap) {
+        int cap = p->chunk_cap ? p->chunk_cap * 2 : 16;
+        char **chunks = realloc(p->chunks, (size_t)cap * sizeof(char *));
+        if (chunks == NULL) {
+            return NULL;
+        }
+        p->chunks = chunks;
+        p->chunk_cap = cap;
+    }
+
+    char *chunk = malloc(size);
+    if (chunk != NULL) {
+        p->chunks[p->chunk_cnt++] = chunk;
+    }
+    return chunk;
+}
+
+// Копирует строку в память пула (вызывается под lock)
+// Длинные строки получают собственный блок, короткие дописываются в текущий
+// Возвращает: указатель на копию или NULL при нехватке памяти
+static const char *pool_copy(InternPool *p, const char *s, size_t n) {
+    char *dst;
+
+    if (n > INTERN_CHUNK / 4) {
+        dst = chunk_new(p, n);
+    } else {
+        if (p->cur == NULL || p->cur_used + n > INTERN_CHUNK) {
+            p->cur = chunk_new(p, INTERN_CHUNK);
+            p->cur_used = 0;
+        }
+        dst = p->cur ? p->cur + p->cur_used : NULL;
+        p->cur_used += n;
+    }
+
+    if (dst != NULL) {
+        memcpy(dst, s, n);
+    }
+    return dst;
+}
+
+// Ищет слот строки в хэш-таблице (вызывается под lock)
+// Возвращает: индекс слота - либо с этой строкой, либо первый пустой
+static uint32_t slot_of(InternPool *p, const char *s, uint32_t h) {
+    uint32_t mask = p->slot_cap - 1;
+    uint32_t i = h & mask;
+
+    while (p->slots[i] != NO_NAME) {
+        if (p->hashes[i] == h && strcmp(intern_str(p, p->slots[i]), s) == 0) {
+            break;
+        }
+        i = (i + 1) & mask;
+    }
+
+    return i;
+}
+
+// Увеличивает хэш-таблицу вдвое и перекладывает дескрипторы (вызывается под lock)
+// Возвращает: 0 при успехе, -1 при нехватке памяти
+static int table_grow(InternPool *p) {
+    uint32_t cap = p->slot_cap ? p->slot_cap * 2 : 1024;
+    Name *slots = calloc(cap, sizeof(Name));
+    uint32_t *hashes = calloc(cap, sizeof(uint32_t));
+    if (slots == NULL || hashes == NULL) {
+        free(slots);
+        free(hashes);
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < p->slot_cap; i++) {
+        if (p->slots[i] == NO_NAME) {
+            continue;
+        }
+        uint32_t j = p->hashes[i] & (cap - 1);
+        while (slots[j] != NO_NAME) {
+            j = (j + 1) & (cap - 1);
+        }
+        slots[j] = p->slots[i];
+        hashes[j] = p->hashes[i];
+    }
+
+    free(p->slots);
+    free(p->hashes);
+    p->slots = slots;
+    p->hashes = hashes;
+    p->slot_cap = cap;
+    return 0;
+}
+
+// Возвращает дескриптор строки, добавляя её в пул при первом обращении
+// Параметры: p - пул, s - строка любой длины
+// Возвращает: дескриптор (> 0) или NO_NAME при нехватке памяти
+Name intern(InternPool *p, const char *s) {
+    uint32_t h = str_hash(s);
+    pthread_mutex_lock(&p->lock);
+
+    if ((p->cnt + 1) * 2 >= p->slot_cap && table_grow(p) != 0) {
+        pthread_mutex_unlock(&p->lock);
+        return NO_NAME;
+    }
+
+    uint32_t i = slot_of(p, s, h);
+    if (p->slots[i] != NO_NAME) {
+        Name n = p->slots[i];
+        pthread_mutex_unlock(&p->lock);
+        return n;
+    }
+
+    Name n = p->cnt + 1;
+    uint32_t page = n / INTERN_PAGE;
+    if (page >= INTERN_PAGES) {
+        pthread_mutex_unlock(&p->lock);
+        return NO_NAME;
+    }
+
+    if (p->pages[page] == NULL) {
+        p->pages[page] = calloc(INTERN_PAGE, sizeof(char *));
+        if (p->pages[page] == NULL) {
+            pthread_mutex_unlock(&p->lock);
+            return NO_NAME;
+        }
+    }
+
+    const char *copy = pool_copy(p, s, strlen(s) + 1);
+    if (copy == NULL) {
+        pthread_mutex_unlock(&p->lock);
+        return NO_NAME;
+    }
+
+    // Публикуем строку до того, как дескриптор станет виден другим потокам
+    __atomic_store_n(&p->pages[page][n % INTERN_PAGE], copy, __ATOMIC_RELEASE);
+    p->slots[i] = n;
+    p->hashes[i] = h;
+    p->cnt = n;
+
+    pthread_mutex_unlock(&p->lock);
+    return n;
+}
+
+// Ищет дескриптор строки, не добавляя её
+// Параметры: p - пул, s - строка
+// Возвращает: дескриптор или NO_NAME, если строка ещё не встречалась
+Name intern_find(InternPool *p, const char *s) {
+    uint32_t h = str_hash(s);
+    pthread_mutex_lock(&p->lock);
+
+    Name n = NO_NAME;
+    if (p->slot_cap > 0) {
+        n = p->slots[slot_of(p, s, h)];
+    }
+
+    pthread_mutex_unlock(&p->lock);
+    return n;
+}
+
+// Возвращает строку по дескриптору (без блокировки)
+// Параметры: p - пул, n - дескриптор, полученный от intern
+const char *intern_str(InternPool *p, Name n) {
+    return __atomic_load_n(&p->pages[n / INTERN_PAGE][n % INTERN_PAGE], __ATOMIC_ACQUIRE);
+}
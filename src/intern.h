@@ -0,0 +1,47 @@
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+#define INTERN_PAGE 4096
+#define INTERN_PAGES 4096
+#define INTERN_CHUNK 65536
+#define NO_NAME 0
+
+typedef uint32_t Name;
+
+// Пул интернированных строк: каждая различная строка хранится один раз,
+// наружу выдаётся стабильный 32-битный дескриптор (Name).
+// Строки лежат в блоках, которые никогда не перемещаются, поэтому
+// intern_str работает без блокировки; добавление и поиск идут под mutex
+typedef struct {
+    pthread_mutex_t lock;
+
+    // Таблица дескриптор -> строка: страницы по INTERN_PAGE указателей
+    const char **pages[INTERN_PAGES];
+    uint32_t cnt;
+
+    // Открытая адресация: слот хранит дескриптор и хэш строки
+    Name *slots;
+    uint32_t *hashes;
+    uint32_t slot_cap;
+
+    // Блоки памяти под сами строки
+    char **chunks;
+    int chunk_cnt;
+    int chunk_cap;
+    char *cur;
+    size_t cur_used;
+} InternPool;
+
+uint32_t str_hash(const char *s);
+
+void intern_init(InternPool *p);
+void intern_free(InternPool *p);
+
+Name intern(InternPool *p, const char *s);
+Name intern_find(InternPool *p, const char *s);
+const char *intern_str(InternPool *p, Name n);
+
+#endif
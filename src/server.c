@@ -1,39 +1,104 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include "func.h"
+#include "store.h"
+#include "trace.h"
+#include "export.h"
 #include <signal.h>
 #include <unistd.h>
 #include <pthread.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/time.h>
+#include <poll.h>
+#include <fcntl.h>
 
 #define ADDR "tcp://*:5555"
+#define REPLY_ADDR "inproc://replies"
 #define MAX_THREAD 50
+#define MAX_QUEUE 1024
+#define MAX_BATCH 64
+#define BATCH 32
+#define QUICK_PLAYERS 2     // игроков в игре, созданной подбором, если клиент не указал
+#define BUSY_RETRY_MS 100
+#define RECV_TIMEOUT 1000   // мс: страховка, чтобы recv на ROUTER не мог остановить главный поток навсегда
+#define RATE_SLOTS 1024
+#define RATE_PROBE 8
+#define MAX_ENDPOINTS 8
+#define HANDOFF_PATH "/tmp/bulls_handoff.sock"
+#define HANDOFF_RETRY_MS 50     // дольше всей передачи: повтор придёт уже новому процессу
+#define HANDOFF_QUIET_US 2000   // тишина на ROUTER перед unbind, чтобы ответы ушли в сеть
+#define HANDOFF_DRAIN_US 200000
+#define HANDOFF_TIMEOUT 10000
+#define HANDOFF_HELLO_MS 100    // сколько ждать "TAKE" от подключившегося (главный поток стоит)
+#define TRACE_PATH "/tmp/bulls_trace.json"
 
+// Адрес, на котором слушает сервер, и его настройки сокета (-1 - не задано)
+// Опции выставляются на ROUTER перед zmq_bind, поэтому действуют только на этот адрес
 typedef struct {
-    char login[MAX_USERNAME];
-    int ok;
-    int tries_cnt;
-} User;
+    char addr[256];
+    int sndhwm;
+    int rcvhwm;
+    int linger;
+    int keepalive;          // ZMQ_TCP_KEEPALIVE (только tcp://)
+    int keepalive_idle;     // ZMQ_TCP_KEEPALIVE_IDLE, секунды
+    int keepalive_intvl;    // ZMQ_TCP_KEEPALIVE_INTVL, секунды
+    char bound[256];        // фактический адрес после bind (для zmq_unbind)
+} Endpoint;
 
+// Настройки сервера (задаются из командной строки или конфигурационного файла)
 typedef struct {
-    char title[MAX_GAME_ID];
-    char secret[WORD_LENGTH + 1];
-    int slots;
-    int users_cnt;
-    User team[MAX_GAME_PLAYERS];
-    int run;
-} Play;
-
-Play all_plays[50];
-int play_cnt = 0;
-int srv_on = 1;
+    int workers;        // рабочих потоков
+    int queue_max;      // максимум запросов в очереди, сверх - отказ "busy"
+    int batch;          // сколько запросов забирать за одно пробуждение (1 - по одному)
+    double rate;        // запросов в секунду на клиента (0 - без лимита)
+    double burst;       // размер всплеска для token bucket
+    int sndhwm;         // ZMQ_SNDHWM по умолчанию для всех адресов
+    int rcvhwm;         // ZMQ_RCVHWM по умолчанию для всех адресов
+    Endpoint ep[MAX_ENDPOINTS];
+    int ep_cnt;
+    char handoff[108];  // Unix сокет для передачи игр новому процессу при перезапуске
+    int takeover;       // забрать игры и адреса у работающего сервера
+    char trace[256];    // куда выгружать трассу (SIGUSR1 включает и выключает запись)
+    int trace_start;    // писать трассу с момента запуска
+    char export[256];   // каталог для выгрузки законченных игр ("" - не выгружать)
+} Config;
+
+Config cfg = {MAX_THREAD, MAX_QUEUE, BATCH, 0, 200, 1000, 1000, {{{0}, 0, 0, 0, 0, 0, 0, {0}}}, 0, HANDOFF_PATH, 0, TRACE_PATH, 0, ""};
+
+PlayStore plays;
+volatile sig_atomic_t srv_on = 1;
+volatile sig_atomic_t trace_flip = 0;
 pthread_mutex_t srv_lock = PTHREAD_MUTEX_INITIALIZER;
 void *zmq_ctx = NULL;
 
 typedef struct {
-    void *s;
     Msg req;
     char id[256];
     int id_len;
+    uint32_t seq;       // номер запроса на сервере (ключ отрезков трассы)
+    uint64_t queued;    // время постановки в очередь, если трасса включена
 } Task;
 
+// Ограниченная очередь запросов (кольцевой буфер) для пула рабочих потоков
+Task **queue = NULL;
+int queue_head = 0;
+int queue_len = 0;
+int inflight = 0;       // принято, но ответ ещё не передан главному потоку
+pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t queue_cond = PTHREAD_COND_INITIALIZER;
+
+// Корзина токенов одного клиента (ключ - ROUTER identity)
+typedef struct {
+    char id[256];
+    int id_len;
+    double tokens;
+    uint64_t last_us;
+} Bucket;
+
+Bucket buckets[RATE_SLOTS];
+
 // Обработчик сигналов для корректного завершения сервера
 // При SIGINT/SIGTERM устанавливаем srv_on=0, на следующем сдвиге цикла сервер выйдет
 void sig_handler(int n) {
@@ -41,420 +106,1223 @@ void sig_handler(int n) {
     srv_on = 0;
 }
 
-Play* get_play(const char *name) {
+// SIGUSR1: включить или выключить трассировку (переключает главный поток)
+void trace_sig(int n) {
+    (void)n;
+    trace_flip = 1;
+}
+
+// Захватывает srv_lock, записывая в трассу время ожидания
+void lock_plays() {
+    uint64_t t = TRACE_START();
     pthread_mutex_lock(&srv_lock);
-    Play *res = NULL;
+    TRACE_END("lock wait", t);
+}
+
+// Завершает игру и ставит её результаты в очередь на выгрузку (вызывается под srv_lock)
+// Параметры: g - индекс игры
+void end_play(int g) {
+    // Выход уже угадавшего игрока из законченной игры не должен выгружать её второй раз
+    if (!plays.run[g]) {
+        return;
+    }
+    store_end(&plays, g);
     
-    for (int i = 0; i < play_cnt; i++) {
-        if (strcmp(all_plays[i].title, name) == 0) {
-            res = &all_plays[i];
-            break;
-        }
+    if (!cfg.export[0]) {
+        return;
     }
     
-    pthread_mutex_unlock(&srv_lock);
-    return res;
+    GameRec r;
+    r.end = plays.last_act[g];
+    r.word_len = plays.word_len[g];
+    r.slots = plays.slots[g];
+    r.players = plays.users_cnt[g];
+    r.won = plays.won_mask[g];
+    r.title = store_title(&plays, g);
+    memcpy(r.secret, plays.secret[g], sizeof(r.secret));
+    for (int u = 0; u < r.players; u++) {
+        r.login[u] = store_login(&plays, g, u);
+        r.tries[u] = plays.tries[g][u];
+    }
+    export_push(&r);
+}
+
+// Заполняет ответ данными игры g: название, число игроков, длина слова и секрет
+// Параметры: g - индекс игры, cmd - тип ответа, res - ответ
+void reply_play(int g, MsgType cmd, Msg *res) {
+    res->cmd = cmd;
+    strcpy(res->game_id, store_title(&plays, g));
+    res->player_cnt = plays.users_cnt[g];
+    res->word_len = plays.word_len[g];
+    strcpy(res->word, plays.secret[g]);  // Отправляем секрет для debug
+}
+
+// Проверяет, не повтор ли это запроса, которым игрок уже вошёл в игру g
+// (клиент не дождался ответа и прислал тот же req_id)
+// Параметры: g - игра или -1, req - запрос
+// Возвращает: 1 если игрок в игре и вошёл именно этим запросом, 0 иначе
+int is_retry(int g, Msg *req) {
+    if (g == -1 || req->req_id == 0) {
+        return 0;
+    }
+    int u = store_find_user(&plays, g, req->user_name);
+    return u != -1 && plays.last_req[g][u] == req->req_id;
 }
 
 // Обрабатывает запрос на создание новой игры (MSG_NEW_GAME)
-// Параметры: req - полученные данные от клиента, res - сообщение для ответа
+// Параметры: g - игра с этим названием или -1, req - полученные данные от клиента, res - сообщение для ответа
 // Логика: проверяет лимиты, генерирует слово, сохраняет игру в списке
-void do_new_play(Msg *req, Msg *res) {
-    pthread_mutex_lock(&srv_lock);
+// Возвращает: индекс игры (новой или уже существующей) или -1
+int do_new_play(int g, Msg *req, Msg *res) {
+    // Ответ на создание потерялся: игра уже создана этим игроком - отвечаем тем же
+    if (is_retry(g, req)) {
+        reply_play(g, MSG_GAME_OK, res);
+        return g;
+    }
     
-    if (play_cnt >= 50) {
+    if (plays.cnt >= MAX_PLAYS) {
         res->cmd = MSG_FAIL;
         strcpy(res->msg, "Server full");
-        pthread_mutex_unlock(&srv_lock);
-        return;
+        return g;
     }
     
     // Check exist
-    for (int i = 0; i < play_cnt; i++) {
-        if (strcmp(all_plays[i].title, req->game_id) == 0) {
-            res->cmd = MSG_FAIL;
-            strcpy(res->msg, "Game exists");
-            pthread_mutex_unlock(&srv_lock);
-            return;
-        }
+    if (g != -1) {
+        res->cmd = MSG_FAIL;
+        strcpy(res->msg, "Game exists");
+        return g;
     }
     
     if (req->player_cnt < 1 || req->player_cnt > MAX_GAME_PLAYERS) {
         res->cmd = MSG_FAIL;
         strcpy(res->msg, "Bad players count");
-        pthread_mutex_unlock(&srv_lock);
-        return;
+        return g;
     }
     
-    Play *p = &all_plays[play_cnt++];
-    strcpy(p->title, req->game_id);
-    p->slots = req->player_cnt;
-    p->users_cnt = 1;
-    p->run = 1;
-    
-    strcpy(p->team[0].login, req->user_name);
-    p->team[0].ok = 1;
-    p->team[0].tries_cnt = 0;
+    int len = req->word_len ? req->word_len : WORD_LENGTH;
+    if (dict_get(len) == NULL) {
+        res->cmd = MSG_FAIL;
+        strcpy(res->msg, "Bad word length");
+        return g;
+    }
     
-    gen_word(p->secret);
+    g = store_add(&plays, req->game_id, req->player_cnt, len);
+    int u = g != -1 ? store_add_user(&plays, g, req->user_name) : -1;
+    if (u == -1) {
+        res->cmd = MSG_FAIL;
+        strcpy(res->msg, "Server full");
+        return g;
+    }
+    plays.last_req[g][u] = req->req_id;
     
-    printf("Создана игра '%s', секрет: %s\n", p->title, p->secret);
+    gen_word(plays.secret[g], len);
     
-    res->cmd = MSG_GAME_OK;
-    strcpy(res->game_id, p->title);
-    res->player_cnt = p->users_cnt;
-    strcpy(res->word, p->secret);  // Отправляем секрет для debug
+    printf("Создана игра '%s', секрет: %s\n", store_title(&plays, g), plays.secret[g]);
     
-    pthread_mutex_unlock(&srv_lock);
+    reply_play(g, MSG_GAME_OK, res);
+    return g;
 }
 
 // Обрабатывает присоединение к существующей игре (MSG_JOIN_BY_ID)
-// Параметры: req - данные игрока, res - ответ
+// Параметры: g - игра или -1, req - данные игрока, res - ответ
 // Логика: поиск игры по имени, проверка места, добавление игрока в список
-void do_join(Msg *req, Msg *res) {
-    pthread_mutex_lock(&srv_lock);
-    
-    Play *p = NULL;
-    for (int i = 0; i < play_cnt; i++) {
-        if (strcmp(all_plays[i].title, req->game_id) == 0) {
-            p = &all_plays[i];
-            break;
-        }
-    }
-    
-    if (p == NULL) {
+void do_join(int g, Msg *req, Msg *res) {
+    if (g == -1) {
         res->cmd = MSG_FAIL;
         strcpy(res->msg, "Game not found");
-        pthread_mutex_unlock(&srv_lock);
         return;
     }
     
-    if (!p->run) {
+    // Ответ на вход потерялся: игрок уже в игре (она могла с тех пор заполниться)
+    if (is_retry(g, req)) {
+        reply_play(g, MSG_JOINED_OK, res);
+        return;
+    }
+    
+    if (!plays.run[g]) {
         res->cmd = MSG_FAIL;
         strcpy(res->msg, "Game ended");
-        pthread_mutex_unlock(&srv_lock);
         return;
     }
     
-    if (p->users_cnt >= p->slots) {
+    if (plays.users_cnt[g] >= plays.slots[g]) {
         res->cmd = MSG_FAIL;
         strcpy(res->msg, "Game full");
-        pthread_mutex_unlock(&srv_lock);
         return;
     }
     
     // Check already joined
-    for (int i = 0; i < p->users_cnt; i++) {
-        if (strcmp(p->team[i].login, req->user_name) == 0) {
-            res->cmd = MSG_FAIL;
-            strcpy(res->msg, "Already in");
-            pthread_mutex_unlock(&srv_lock);
-            return;
-        }
+    if (store_find_user(&plays, g, req->user_name) != -1) {
+        res->cmd = MSG_FAIL;
+        strcpy(res->msg, "Already in");
+        return;
     }
     
-    int idx = p->users_cnt++;
-    strcpy(p->team[idx].login, req->user_name);
-    p->team[idx].ok = 1;
-    p->team[idx].tries_cnt = 0;
-    
-        printf("Игрок '%s' присоединился к '%s' (%d/%d)\n", req->user_name, p->title, 
-            p->users_cnt, p->slots);
+    int u = store_add_user(&plays, g, req->user_name);
+    if (u == -1) {
+        res->cmd = MSG_FAIL;
+        strcpy(res->msg, "Server full");
+        return;
+    }
+    plays.last_req[g][u] = req->req_id;
     
-    res->cmd = MSG_JOINED_OK;
-    strcpy(res->game_id, p->title);
-    res->player_cnt = p->users_cnt;
-    strcpy(res->word, p->secret);  // Отправляем секрет для debug
+        printf("Игрок '%s' присоединился к '%s' (%d/%d)\n", req->user_name, store_title(&plays, g), 
+            plays.users_cnt[g], plays.slots[g]);
     
-    pthread_mutex_unlock(&srv_lock);
+    reply_play(g, MSG_JOINED_OK, res);
 }
 
 // Обрабатывает попытку угадать слово (MSG_MAKE_TRY)
-// Параметры: req - слово и инфо от клиента, res - ответ
+// Параметры: g - игра или -1, req - слово и инфо от клиента, res - ответ
 // Логика: проверка слова, подсчёт быков/коров, проверка победы
-void do_try(Msg *req, Msg *res) {
-    pthread_mutex_lock(&srv_lock);
-    
-    Play *p = NULL;
-    for (int i = 0; i < play_cnt; i++) {
-        if (strcmp(all_plays[i].title, req->game_id) == 0) {
-            p = &all_plays[i];
-            break;
-        }
-    }
-    
-    if (p == NULL) {
+void do_try(int g, Msg *req, Msg *res) {
+    if (g == -1) {
         res->cmd = MSG_FAIL;
         strcpy(res->msg, "No game");
-        pthread_mutex_unlock(&srv_lock);
-        return;
-    }
-    
-    if (!p->run) {
-        res->cmd = MSG_FAIL;
-        strcpy(res->msg, "Game done");
-        pthread_mutex_unlock(&srv_lock);
         return;
     }
     
     // Find user
-    User *u = NULL;
-    for (int i = 0; i < p->users_cnt; i++) {
-        if (strcmp(p->team[i].login, req->user_name) == 0) {
-            u = &p->team[i];
-            break;
-        }
-    }
+    int u = store_find_user(&plays, g, req->user_name);
     
-    if (u == NULL) {
+    if (u == -1) {
         res->cmd = MSG_FAIL;
         strcpy(res->msg, "User not in game");
-        pthread_mutex_unlock(&srv_lock);
         return;
     }
     
+    int len = plays.word_len[g];
+    
     // Проверяем только длину и буквы (не словарь)
-    if (strlen(req->word) != WORD_LENGTH) {
+    if (strlen(req->word) != (size_t)len) {
         res->cmd = MSG_FAIL;
         strcpy(res->msg, "Bad length");
-        pthread_mutex_unlock(&srv_lock);
         return;
     }
     
-    for (int i = 0; i < WORD_LENGTH; i++) {
-        if (req->word[i] < 'a' || req->word[i] > 'z') {
-            res->cmd = MSG_FAIL;
-            strcpy(res->msg, "Bad chars");
-            pthread_mutex_unlock(&srv_lock);
-            return;
-        }
+    if (!word_chars_ok(req->word, len)) {
+        res->cmd = MSG_FAIL;
+        strcpy(res->msg, "Bad chars");
+        return;
     }
     
-    u->tries_cnt++;
+    // Клиент не дождался ответа и повторил ту же попытку (тот же req_id):
+    // отвечаем тем же результатом, не засчитывая попытку второй раз
+    int dup = req->req_id != 0 && plays.last_req[g][u] == req->req_id;
+    
+    if (!dup && !plays.run[g]) {
+        res->cmd = MSG_FAIL;
+        strcpy(res->msg, "Game done");
+        return;
+    }
+    
+    if (!dup) {
+        plays.tries[g][u]++;
+        plays.last_req[g][u] = req->req_id;
+        store_touch(&plays, g);
+    }
+    int tries = plays.tries[g][u];
     
     int b = 0, c = 0;
-    check_word(p->secret, req->word, &b, &c);
+    uint64_t t = TRACE_START();
+    check_word(plays.secret[g], req->word, len, &b, &c);
+    TRACE_END("check_word", t);
     
-        printf("Игрок '%s' в '%s': попытка %d - %s -> %dБ %dК\n",
-            req->user_name, p->title, u->tries_cnt, req->word, b, c);
+    t = TRACE_START();
+        printf("Игрок '%s' в '%s': попытка %d%s - %s -> %dБ %dК\n",
+            req->user_name, store_title(&plays, g), tries, dup ? " (повтор)" : "", req->word, b, c);
+    TRACE_END("log", t);
     
     res->res.bulls = b;
     res->res.cows = c;
-    res->res.try_num = u->tries_cnt;
-    strcpy(res->res.who, u->login);
+    res->res.try_num = tries;
+    strcpy(res->res.who, store_login(&plays, g, u));
     
-    if (b == WORD_LENGTH) {
+    if (b == len && dup) {
+        res->cmd = MSG_WIN;
+    } else if (b == len) {
         // Игрок выиграл - помечаем его неактивным
-        u->ok = 0;
+        plays.ok_mask[g] &= (uint16_t)~(1u << u);
+        plays.won_mask[g] |= (uint16_t)(1u << u);
         res->cmd = MSG_WIN;
-        printf("Победитель: '%s' в игре '%s'\n", u->login, p->title);
-        
-        // Проверяем, осталось ли активных игроков
-        int active_cnt = 0;
-        for (int j = 0; j < p->users_cnt; j++) {
-            if (p->team[j].ok) {
-                active_cnt++;
-            }
-        }
+        printf("Победитель: '%s' в игре '%s'\n", store_login(&plays, g, u), store_title(&plays, g));
         
         // Если активных игроков больше нет - завершаем игру
-        if (active_cnt == 0) {
-            p->run = 0;
-            printf("Игра '%s' завершена (все угадали или вышли)\n", p->title);
+        if (store_active(&plays, g) == 0) {
+            end_play(g);
+            printf("Игра '%s' завершена (все угадали или вышли)\n", store_title(&plays, g));
         }
     } else {
         res->cmd = MSG_TRY_RESULT;
     }
     
-    strcpy(res->game_id, p->title);
-    
-    pthread_mutex_unlock(&srv_lock);
+    strcpy(res->game_id, store_title(&plays, g));
 }
 
 // Обрабатывает выход игрока из игры (MSG_QUIT_GAME)
-// Параметры: req - имя игры и игрока, res - ответ
+// Параметры: g - игра или -1, req - имя игры и игрока, res - ответ
 // Логика: помечает игрока как неактивного; если активных не осталось - игра завершается
-void do_quit(Msg *req, Msg *res) {
-    pthread_mutex_lock(&srv_lock);
+void do_quit(int g, Msg *req, Msg *res) {
+    if (g == -1) {
+        res->cmd = MSG_FAIL;
+        strcpy(res->msg, "Game not found");
+        return;
+    }
     
-    Play *p = NULL;
-    for (int i = 0; i < play_cnt; i++) {
-        if (strcmp(all_plays[i].title, req->game_id) == 0) {
-            p = &all_plays[i];
-            break;
+    // Find user and mark inactive
+    int u = store_find_user(&plays, g, req->user_name);
+    if (u != -1) {
+        plays.ok_mask[g] &= (uint16_t)~(1u << u);
+        store_touch(&plays, g);
+        printf("Игрок '%s' вышел из игры '%s'\n", req->user_name, store_title(&plays, g));
+        
+        // Check if any active players left
+        if (store_active(&plays, g) == 0) {
+            end_play(g);
+            printf("Игра '%s' завершена (нет активных игроков)\n", store_title(&plays, g));
         }
     }
     
-    if (p == NULL) {
+    res->cmd = MSG_GAME_OK;
+    strcpy(res->game_id, store_title(&plays, g));
+}
+
+// Подбирает игроку игру (MSG_QUICK_JOIN): самую заполненную из идущих игр
+// с той же длиной слова и свободным местом, а если таких нет - создаёт новую
+// Параметры: req - имя игрока, длина слова и размер новой игры (0 - по умолчанию), res - ответ
+void do_quick_join(Msg *req, Msg *res) {
+    static uint32_t quick_seq = 0;
+    
+    // Повтор запроса, ответ на который потерялся: та же игра, что и в первый раз,
+    // даже если тот вход заполнил её и она ушла из подбора
+    int g = store_quick_find(&plays, req->user_name, req->req_id);
+    if (g != -1) {
+        reply_play(g, MSG_JOINED_OK, res);
+        return;
+    }
+    
+    int len = req->word_len ? req->word_len : WORD_LENGTH;
+    if (dict_get(len) == NULL) {
         res->cmd = MSG_FAIL;
-        strcpy(res->msg, "Game not found");
-        pthread_mutex_unlock(&srv_lock);
+        strcpy(res->msg, "Bad word length");
         return;
     }
     
-    // Find user and mark inactive
-    for (int i = 0; i < p->users_cnt; i++) {
-        if (strcmp(p->team[i].login, req->user_name) == 0) {
-            p->team[i].ok = 0;
-            printf("Игрок '%s' вышел из игры '%s'\n", req->user_name, p->title);
-            
-            // Check if any active players left
-            int active_cnt = 0;
-            for (int j = 0; j < p->users_cnt; j++) {
-                if (p->team[j].ok) {
-                    active_cnt++;
-                }
-            }
-            
-            if (active_cnt == 0) {
-                p->run = 0;
-                printf("Игра '%s' завершена (нет активных игроков)\n", p->title);
-            }
-            
-            break;
+    // Игры, где игрок уже был, подбор пропускает
+    g = store_open_best(&plays, len, req->user_name);
+    
+    if (g == -1) {
+        int slots = req->player_cnt;
+        if (slots < 1 || slots > MAX_GAME_PLAYERS) {
+            slots = QUICK_PLAYERS;
         }
+        
+        char name[MAX_GAME_ID];
+        do {
+            snprintf(name, sizeof(name), "quick-%u", ++quick_seq);
+        } while (store_find(&plays, name) != -1);
+        
+        g = store_add(&plays, name, slots, len);
+        if (g == -1) {
+            res->cmd = MSG_FAIL;
+            strcpy(res->msg, "Server full");
+            return;
+        }
+        
+        gen_word(plays.secret[g], len);
+        printf("Создана игра '%s', секрет: %s\n", store_title(&plays, g), plays.secret[g]);
     }
     
-    res->cmd = MSG_GAME_OK;
-    strcpy(res->game_id, p->title);
+    int u = store_add_user(&plays, g, req->user_name);
+    if (u == -1 || store_quick_set(&plays, g, u, req->req_id) != 0) {
+        res->cmd = MSG_FAIL;
+        strcpy(res->msg, "Server full");
+        return;
+    }
+    plays.last_req[g][u] = req->req_id;
     
-    pthread_mutex_unlock(&srv_lock);
+    printf("Игрок '%s' подобран в '%s' (%d/%d)\n", req->user_name, store_title(&plays, g),
+        plays.users_cnt[g], plays.slots[g]);
+    
+    reply_play(g, MSG_JOINED_OK, res);
 }
 
 // Обрабатывает запрос списка активных игр (MSG_GET_GAMES)
 // Параметры: req - обыкно пустое сообщение, res - ответ
-// Логика: просто считаем кол-во активных игр и возвращаем
+// Логика: просто считаем кол-во активных игр и возвращаем (читаем только плотный массив run)
 void do_list(Msg *req, Msg *res) {
     (void)req;
-    pthread_mutex_lock(&srv_lock);
     
     res->cmd = MSG_GAMES_LIST;
     res->total_games = 0;
     
-    for (int i = 0; i < play_cnt; i++) {
-        if (all_plays[i].run) {
-            res->total_games++;
-        }
+    for (int i = 0; i < plays.cnt; i++) {
+        res->total_games += plays.run[i];
     }
     
     printf("Список игр: активных %d\n", res->total_games);
-    
-    pthread_mutex_unlock(&srv_lock);
 }
 
 // Диспетчер команд: рамбует всех виды сообщений на конкретные обработчики
-// Параметры: req - полученное месседж, res - для составления ответа
-void work_msg(Msg *req, Msg *res) {
+// Вызывается под srv_lock; игра уже найдена по req->game_id
+// Параметры: g - игра или -1, req - полученное месседж, res - для составления ответа
+// Возвращает: индекс игры после запроса (MSG_NEW_GAME мог её создать)
+int work_msg(int g, Msg *req, Msg *res) {
     msg_create(res);
+    res->req_id = req->req_id;
     
     switch (req->cmd) {
         case MSG_NEW_GAME:
-            do_new_play(req, res);
+            g = do_new_play(g, req, res);
             break;
         case MSG_JOIN_BY_ID:
-            do_join(req, res);
+            do_join(g, req, res);
             break;
         case MSG_MAKE_TRY:
-            do_try(req, res);
+            do_try(g, req, res);
             break;
         case MSG_QUIT_GAME:
-            do_quit(req, res);
+            do_quit(g, req, res);
             break;
         case MSG_GET_GAMES:
             do_list(req, res);
             break;
+        case MSG_QUICK_JOIN:
+            do_quick_join(req, res);
+            break;
         default:
             res->cmd = MSG_FAIL;
             strcpy(res->msg, "Unknown cmd");
     }
+    
+    return g;
+}
+
+// Обрабатывает пачку запросов, сгруппировав их по названию игры:
+// на группу - один захват srv_lock и один поиск игры, порядок внутри группы сохраняется
+// Параметры: t - запросы, n - их число, res - ответы (по одному на запрос)
+void work_batch(Task **t, int n, Msg *res) {
+    uint32_t hash[MAX_BATCH];
+    uint8_t done[MAX_BATCH] = {0};
+    
+    for (int i = 0; i < n; i++) {
+        hash[i] = str_hash(t[i]->req.game_id);
+    }
+    
+    for (int i = 0; i < n; i++) {
+        if (done[i]) {
+            continue;
+        }
+        
+        trace_key(t[i]->seq);
+        uint64_t start = TRACE_START();
+        lock_plays();
+        
+        int g = store_find(&plays, t[i]->req.game_id);
+        for (int j = i; j < n; j++) {
+            if (!done[j] && hash[j] == hash[i] && strcmp(t[j]->req.game_id, t[i]->req.game_id) == 0) {
+                g = work_msg(g, &t[j]->req, &res[j]);
+                done[j] = 1;
+            }
+        }
+        
+        pthread_mutex_unlock(&srv_lock);
+        TRACE_END("handle", start);
+    }
 }
 
-// Поток для обработки одного клиентского запроса
-// Параметры: arg - указатель на Task (запрос с данными и сокетом)
-// Логика: вызываем work_msg, отправляем ответ назад клиенту
-void* client_thread(void* arg) {
-    Task *t = (Task*)arg;
+// Ищет корзину токенов клиента по ROUTER identity (вызывается только из главного потока)
+// Смотрим несколько соседних слотов; если клиента нет - занимаем самый давно использованный
+// Параметры: id, len - identity клиента, now - текущее время в мкс
+Bucket* bucket_get(const char *id, int len, uint64_t now) {
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < len; i++) {
+        h ^= (unsigned char)id[i];
+        h *= 16777619u;
+    }
+    
+    Bucket *old = NULL;
+    for (int k = 0; k < RATE_PROBE; k++) {
+        Bucket *b = &buckets[(h + k) & (RATE_SLOTS - 1)];
+        if (b->id_len == len && memcmp(b->id, id, len) == 0) {
+            return b;
+        }
+        if (old == NULL || b->last_us < old->last_us) {
+            old = b;
+        }
+    }
+    
+    memcpy(old->id, id, len);
+    old->id_len = len;
+    old->tokens = cfg.burst;
+    old->last_us = now;
+    return old;
+}
+
+// Проверяет лимит частоты запросов клиента (token bucket)
+// Параметры: t - запрос, retry_ms - куда записать, через сколько повторить
+// Возвращает: 1 если запрос можно принять, 0 если лимит исчерпан
+int rate_ok(Task *t, int *retry_ms) {
+    if (cfg.rate <= 0) {
+        return 1;
+    }
+    
+    uint64_t now = now_us();
+    Bucket *b = bucket_get(t->id, t->id_len, now);
+    
+    b->tokens += (now - b->last_us) / 1e6 * cfg.rate;
+    if (b->tokens > cfg.burst) {
+        b->tokens = cfg.burst;
+    }
+    b->last_us = now;
+    
+    if (b->tokens < 1.0) {
+        *retry_ms = (int)((1.0 - b->tokens) * 1000.0 / cfg.rate) + 1;
+        return 0;
+    }
+    
+    b->tokens -= 1.0;
+    return 1;
+}
+
+// Кладёт запросы в очередь для рабочих потоков одним захватом queue_lock
+// Параметры: t - запросы, n - их число
+// Возвращает: сколько первых запросов поместилось
+int queue_push(Task **t, int n) {
+    pthread_mutex_lock(&queue_lock);
+    
+    int k = 0;
+    while (k < n && queue_len < cfg.queue_max) {
+        queue[(queue_head + queue_len) % cfg.queue_max] = t[k++];
+        queue_len++;
+    }
+    __atomic_add_fetch(&inflight, k, __ATOMIC_RELAXED);
+    
+    // Один поток забирает сразу пачку, остальные будятся, если запросов больше пачки
+    if (k > cfg.batch) {
+        pthread_cond_broadcast(&queue_cond);
+    } else if (k > 0) {
+        pthread_cond_signal(&queue_cond);
+    }
+    pthread_mutex_unlock(&queue_lock);
+    return k;
+}
+
+// Забирает из очереди до max запросов, ждёт если очередь пуста
+// Параметры: t - куда сложить запросы, max - сколько забрать не более
+// Возвращает: число запросов или 0 при остановке сервера
+int queue_pop(Task **t, int max) {
+    pthread_mutex_lock(&queue_lock);
+    
+    while (queue_len == 0 && srv_on) {
+        pthread_cond_wait(&queue_cond, &queue_lock);
+    }
+    
+    int n = 0;
+    while (n < max && queue_len > 0) {
+        t[n++] = queue[queue_head];
+        queue_head = (queue_head + 1) % cfg.queue_max;
+        queue_len--;
+    }
+    
+    pthread_mutex_unlock(&queue_lock);
+    return n;
+}
+
+// Отправляет клиенту быстрый отказ "busy" с подсказкой, когда повторить
+// Параметры: sock - ROUTER сокет, t - запрос, retry_ms - через сколько повторить
+void send_busy(void *sock, Task *t, int retry_ms) {
     Msg res;
+    msg_create(&res);
+    res.cmd = MSG_FAIL;
+    res.req_id = t->req.req_id;
+    res.retry_ms = retry_ms;
+    strcpy(res.msg, "busy");
     
-    work_msg(&t->req, &res);
+    zmq_send(sock, t->id, t->id_len, ZMQ_SNDMORE);
+    zmq_send(sock, "", 0, ZMQ_SNDMORE);
+    zmq_send(sock, &res, sizeof(Msg), 0);
+}
+
+// Рабочий поток: берёт запросы из очереди и обрабатывает их
+// Ответ уходит через свой PUSH сокет в главный поток, который единственный пишет в ROUTER
+// Параметры: arg - не используется
+void* worker_thread(void* arg) {
+    (void)arg;
+    void *out = zmq_socket(zmq_ctx, ZMQ_PUSH);
+    zmq_connect(out, REPLY_ADDR);
+    trace_thread("worker");
     
-    zmq_send(t->s, t->id, t->id_len, ZMQ_SNDMORE);
-    zmq_send(t->s, "", 0, ZMQ_SNDMORE);
-    zmq_send(t->s, &res, sizeof(Msg), 0);
+    Task *t[MAX_BATCH];
+    Msg res[MAX_BATCH];
+    int n;
+    while ((n = queue_pop(t, cfg.batch)) > 0) {
+        for (int i = 0; i < n; i++) {
+            trace_key(t[i]->seq);
+            TRACE_END("queue wait", t[i]->queued);
+        }
+        
+        work_batch(t, n, res);
+        
+        // Все ответы пачки - одним составным сообщением: тройки (identity, ответ, номер)
+        uint64_t start = TRACE_START();
+        for (int i = 0; i < n; i++) {
+            zmq_send(out, t[i]->id, t[i]->id_len, ZMQ_SNDMORE);
+            zmq_send(out, &res[i], sizeof(Msg), ZMQ_SNDMORE);
+            zmq_send(out, &t[i]->seq, sizeof(t[i]->seq), i + 1 < n ? ZMQ_SNDMORE : 0);
+        }
+        TRACE_END("reply push", start);
+        __atomic_sub_fetch(&inflight, n, __ATOMIC_RELEASE);
+        
+        for (int i = 0; i < n; i++) {
+            free(t[i]);
+        }
+    }
     
-    free(t);
+    int linger = 0;
+    zmq_setsockopt(out, ZMQ_LINGER, &linger, sizeof(linger));
+    zmq_close(out);
     return NULL;
 }
 
+// Разбирает адрес с опциями вида "tcp://*:5555?sndhwm=5000&keepalive=1&linger=0"
+// Адреса inproc:// не принимаются: контекст ZeroMQ сервера закрыт, подключиться к ним некому
+// Параметры: spec - строка адреса, e - куда записать результат
+// Возвращает: 0 при успехе, -1 при неизвестной опции или неподходящем адресе
+int parse_endpoint(const char *spec, Endpoint *e) {
+    char buf[512];
+    snprintf(buf, sizeof(buf), "%s", spec);
+    
+    e->sndhwm = e->rcvhwm = e->linger = -1;
+    e->keepalive = e->keepalive_idle = e->keepalive_intvl = -1;
+    
+    char *opts = strchr(buf, '?');
+    if (opts != NULL) {
+        *opts++ = 0;
+    }
+    if (strlen(buf) >= sizeof(e->addr) || strncmp(buf, "inproc://", 9) == 0) {
+        return -1;
+    }
+    strcpy(e->addr, buf);
+    
+    char *save = NULL;
+    for (char *kv = opts ? strtok_r(opts, "&", &save) : NULL; kv != NULL; kv = strtok_r(NULL, "&", &save)) {
+        char *eq = strchr(kv, '=');
+        if (eq == NULL) {
+            return -1;
+        }
+        *eq = 0;
+        int v = atoi(eq + 1);
+        
+        if (strcmp(kv, "sndhwm") == 0) e->sndhwm = v;
+        else if (strcmp(kv, "rcvhwm") == 0) e->rcvhwm = v;
+        else if (strcmp(kv, "linger") == 0) e->linger = v;
+        else if (strcmp(kv, "keepalive") == 0) e->keepalive = v;
+        else if (strcmp(kv, "keepalive_idle") == 0) e->keepalive_idle = v;
+        else if (strcmp(kv, "keepalive_intvl") == 0) e->keepalive_intvl = v;
+        else return -1;
+    }
+    
+    return 0;
+}
+
+// Применяет одну настройку (из командной строки или файла) к cfg
+// Параметры: key - имя настройки, val - значение
+// Возвращает: 0 при успехе, -1 при неизвестном ключе
+int set_opt(const char *key, const char *val) {
+    if (strcmp(key, "workers") == 0) cfg.workers = atoi(val);
+    else if (strcmp(key, "queue") == 0) cfg.queue_max = atoi(val);
+    else if (strcmp(key, "batch") == 0) cfg.batch = atoi(val);
+    else if (strcmp(key, "rate") == 0) cfg.rate = atof(val);
+    else if (strcmp(key, "burst") == 0) cfg.burst = atof(val);
+    else if (strcmp(key, "sndhwm") == 0) cfg.sndhwm = atoi(val);
+    else if (strcmp(key, "rcvhwm") == 0) cfg.rcvhwm = atoi(val);
+    else if (strcmp(key, "export") == 0) snprintf(cfg.export, sizeof(cfg.export), "%s", val);
+    else if (strcmp(key, "handoff") == 0) snprintf(cfg.handoff, sizeof(cfg.handoff), "%s", val);
+    else if (strcmp(key, "trace") == 0) {
+        snprintf(cfg.trace, sizeof(cfg.trace), "%s", val);
+        cfg.trace_start = 1;
+    }
+    else if (strcmp(key, "endpoint") == 0) {
+        if (cfg.ep_cnt >= MAX_ENDPOINTS) {
+            return -1;
+        }
+        return parse_endpoint(val, &cfg.ep[cfg.ep_cnt++]);
+    }
+    else return -1;
+    
+    return 0;
+}
+
+// Разбирает параметры командной строки в cfg; -c подгружает файл в том месте,
+// где он указан, поэтому следующие за ним ключи переопределяют значения из файла
+// Возвращает: 0 при успехе, -1 при ошибке
+int parse_args(int argc, char **argv) {
+    int opt;
+    int rc = 0;
+    
+    while (rc == 0 && (opt = getopt(argc, argv, "c:e:w:q:B:r:b:s:R:H:Tt:x:")) != -1) {
+        switch (opt) {
+            case 'c': rc = conf_load(optarg, set_opt); break;
+            case 'e': rc = set_opt("endpoint", optarg); break;
+            case 'w': rc = set_opt("workers", optarg); break;
+            case 'q': rc = set_opt("queue", optarg); break;
+            case 'B': rc = set_opt("batch", optarg); break;
+            case 'r': rc = set_opt("rate", optarg); break;
+            case 'b': rc = set_opt("burst", optarg); break;
+            case 's': rc = set_opt("sndhwm", optarg); break;
+            case 'R': rc = set_opt("rcvhwm", optarg); break;
+            case 'H': rc = set_opt("handoff", optarg); break;
+            case 'T': cfg.takeover = 1; break;
+            case 't': rc = set_opt("trace", optarg); break;
+            case 'x': rc = set_opt("export", optarg); break;
+            default: return -1;
+        }
+    }
+    
+    if (rc != 0 || cfg.workers < 1 || cfg.queue_max < 1 || cfg.burst < 1
+            || cfg.batch < 1 || cfg.batch > MAX_BATCH) {
+        return -1;
+    }
+    
+    if (cfg.ep_cnt == 0) {
+        parse_endpoint(ADDR, &cfg.ep[cfg.ep_cnt++]);
+    }
+    return 0;
+}
+
+// Выставляет опции адреса на ROUTER сокет и привязывает его
+// Параметры: sock - ROUTER сокет, e - адрес с опциями
+// Возвращает: результат zmq_bind
+int bind_endpoint(void *sock, Endpoint *e) {
+    int sndhwm = e->sndhwm >= 0 ? e->sndhwm : cfg.sndhwm;
+    int rcvhwm = e->rcvhwm >= 0 ? e->rcvhwm : cfg.rcvhwm;
+    
+    zmq_setsockopt(sock, ZMQ_SNDHWM, &sndhwm, sizeof(sndhwm));
+    zmq_setsockopt(sock, ZMQ_RCVHWM, &rcvhwm, sizeof(rcvhwm));
+    zmq_setsockopt(sock, ZMQ_TCP_KEEPALIVE, &e->keepalive, sizeof(e->keepalive));
+    zmq_setsockopt(sock, ZMQ_TCP_KEEPALIVE_IDLE, &e->keepalive_idle, sizeof(e->keepalive_idle));
+    zmq_setsockopt(sock, ZMQ_TCP_KEEPALIVE_INTVL, &e->keepalive_intvl, sizeof(e->keepalive_intvl));
+    // Как и keepalive, linger выставляется каждый раз: иначе значение одного адреса
+    // досталось бы всем, привязанным после него (-1 - значение ZeroMQ по умолчанию)
+    zmq_setsockopt(sock, ZMQ_LINGER, &e->linger, sizeof(e->linger));
+    
+    if (zmq_bind(sock, e->addr) != 0) {
+        return -1;
+    }
+    
+    size_t n = sizeof(e->bound);
+    zmq_getsockopt(sock, ZMQ_LAST_ENDPOINT, e->bound, &n);
+    return 0;
+}
+
+// Привязывает ROUTER ко всем адресам из cfg
+// Параметры: sock - ROUTER сокет, wait_ms - сколько ждать, пока адрес освободит старый процесс
+// Возвращает: 0 при успехе, -1 при ошибке
+int bind_all(void *sock, int wait_ms) {
+    for (int i = 0; i < cfg.ep_cnt; i++) {
+        int rc;
+        for (int k = 0; (rc = bind_endpoint(sock, &cfg.ep[i])) != 0 && k < wait_ms; k++) {
+            if (zmq_errno() != EADDRINUSE) {
+                break;
+            }
+            struct timespec ts = {0, 1000000};
+            nanosleep(&ts, NULL);
+        }
+        if (rc != 0) {
+            printf("Bind error: %s (%s)\n", cfg.ep[i].addr, zmq_strerror(zmq_errno()));
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Пересылает клиентам все готовые ответы рабочих потоков
+// Параметры: sock - ROUTER сокет, replies - PULL сокет с ответами
+void forward_replies(void *sock, void *replies) {
+    char id[256];
+    Msg res;
+    uint32_t seq;
+    int id_len;
+    
+    int more;
+    size_t more_len = sizeof(more);
+    
+    // Сообщение от рабочего потока - пачка троек (identity, ответ, номер)
+    while ((id_len = zmq_recv(replies, id, sizeof(id), ZMQ_DONTWAIT)) != -1) {
+        do {
+            uint64_t t = TRACE_START();
+            zmq_recv(replies, &res, sizeof(Msg), 0);
+            zmq_recv(replies, &seq, sizeof(seq), 0);
+            zmq_send(sock, id, id_len, ZMQ_SNDMORE);
+            zmq_send(sock, "", 0, ZMQ_SNDMORE);
+            zmq_send(sock, &res, sizeof(Msg), 0);
+            trace_key(seq);
+            TRACE_END("reply send", t);
+            
+            zmq_getsockopt(replies, ZMQ_RCVMORE, &more, &more_len);
+        } while (more && (id_len = zmq_recv(replies, id, sizeof(id), 0)) != -1);
+    }
+}
+
+// Выгружает трассу в cfg.trace и печатает итог
+void trace_save() {
+    long n = trace_dump(cfg.trace);
+    if (n < 0) {
+        printf("Не удалось записать трассу в %s\n", cfg.trace);
+    } else {
+        printf("Трасса: %ld отрезков в %s\n", n, cfg.trace);
+    }
+}
+
+// Есть ли у принятой части сообщения продолжение
+int recv_more(void *sock) {
+    int more = 0;
+    size_t len = sizeof(more);
+    zmq_getsockopt(sock, ZMQ_RCVMORE, &more, &len);
+    return more;
+}
+
+// Читает один запрос из ROUTER в task
+// Запрос - ровно три части: identity, пустой разделитель, Msg целиком. Сообщение другого
+// вида дочитывается до конца и выбрасывается: иначе его хвост приняли бы за начало
+// следующего запроса, и разбор всех последующих сбился бы
+// Возвращает: 0 при успехе, 1 если сообщение отброшено, -1 если сообщений нет
+int recv_task(void *sock, Task *task) {
+    task->id_len = zmq_recv(sock, task->id, 256, ZMQ_DONTWAIT);
+    if (task->id_len == -1) {
+        return -1;
+    }
+    
+    // Части составного сообщения приходят вместе, поэтому дальше recv не ждёт
+    char delim[10];
+    int delim_len = recv_more(sock) ? zmq_recv(sock, delim, sizeof(delim), 0) : -1;
+    int body_len = delim_len == 0 && recv_more(sock) ? zmq_recv(sock, &task->req, sizeof(Msg), 0) : -1;
+    
+    if (task->id_len > 256 || body_len != (int)sizeof(Msg) || recv_more(sock)) {
+        while (recv_more(sock) && zmq_recv(sock, delim, sizeof(delim), 0) != -1) {
+        }
+        return 1;
+    }
+    
+    // Строки из сети могут прийти без нуля в конце - обрезаем по размеру буферов
+    task->req.game_id[MAX_GAME_ID - 1] = 0;
+    task->req.user_name[MAX_USERNAME - 1] = 0;
+    task->req.word[MAX_WORD_LENGTH] = 0;
+    return 0;
+}
+
+// Открывает Unix сокет, к которому подключается новый процесс при перезапуске
+// Путь к этому моменту либо ничей (handoff_alive), либо остался от процесса,
+// который только что передал нам игры, поэтому старый файл можно удалить.
+// Сокет неблокирующий: accept после zmq_poll не должен ждать, если клиент уже отключился
+// Возвращает: дескриптор или -1
+int handoff_listen(const char *path) {
+    struct sockaddr_un a;
+    memset(&a, 0, sizeof(a));
+    a.sun_family = AF_UNIX;
+    snprintf(a.sun_path, sizeof(a.sun_path), "%s", path);
+    
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    
+    unlink(path);
+    if (bind(fd, (struct sockaddr*)&a, sizeof(a)) != 0 || listen(fd, 1) != 0
+            || fcntl(fd, F_SETFL, O_NONBLOCK) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Подключается к Unix сокету работающего сервера
+// Возвращает: дескриптор или -1
+int handoff_connect(const char *path) {
+    struct sockaddr_un a;
+    memset(&a, 0, sizeof(a));
+    a.sun_family = AF_UNIX;
+    snprintf(a.sun_path, sizeof(a.sun_path), "%s", path);
+    
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (connect(fd, (struct sockaddr*)&a, sizeof(a)) != 0) {
+        close(fd);
+        return -1;
+    }
+    
+    struct timeval tv = {HANDOFF_TIMEOUT / 1000, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    return fd;
+}
+
+// Проверяет, отвечает ли на path работающий сервер
+// Возвращает: 1 если отвечает, 0 если сокета нет или он остался от упавшего процесса
+int handoff_alive(const char *path) {
+    int fd = handoff_connect(path);
+    if (fd < 0) {
+        return 0;
+    }
+    close(fd);
+    return 1;
+}
+
+// Старый процесс: отдаёт игры новому, подключившемуся к handoff сокету
+// 1) дожидается ответов на уже принятые запросы; 2) освобождает адреса;
+// 3) пишет хранилище в сокет; 4) ждёт от нового "DONE" (он привязал адреса).
+// Всё это время новые запросы получают "busy" с коротким retry_ms - клиент повторит их уже новому процессу
+// Параметры: lfd - слушающий Unix сокет, sock - ROUTER, replies - PULL с ответами
+// Возвращает: 1 если игры переданы и процесс должен завершиться, 0 если передача не удалась,
+// -1 если передача не удалась и адреса не удалось занять обратно (работать дальше нельзя)
+int handoff_give(int lfd, void *sock, void *replies) {
+    int cfd = accept(lfd, NULL, NULL);
+    if (cfd < 0) {
+        return 0;
+    }
+    
+    // Запросы не обслуживаются, пока ждём: подключившийся, но молчащий
+    // (или чужой) процесс задерживает сервер не больше HANDOFF_HELLO_MS
+    struct pollfd hello = {cfd, POLLIN, 0};
+    char cmd[4];
+    if (poll(&hello, 1, HANDOFF_HELLO_MS) != 1 || read(cfd, cmd, 4) != 4 || memcmp(cmd, "TAKE", 4) != 0) {
+        close(cfd);
+        return 0;
+    }
+    
+    struct timeval tv = {HANDOFF_TIMEOUT / 1000, 0};
+    setsockopt(cfd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(cfd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    
+    printf("Передача игр новому процессу...\n");
+    uint64_t start = now_us();
+    long busy = 0;
+    
+    zmq_pollitem_t items[3] = {
+        {sock, 0, ZMQ_POLLIN, 0},
+        {replies, 0, ZMQ_POLLIN, 0},
+        {NULL, cfd, ZMQ_POLLIN, 0},
+    };
+    
+    // Ждём ответы на уже принятые запросы, новые - отклоняем.
+    // Адреса освобождаем, только когда клиенты замолчали: всё, что в этот момент
+    // было бы в пути (запрос или ответ), при unbind потерялось бы до таймаута клиента
+    uint64_t last = start;
+    while ((__atomic_load_n(&inflight, __ATOMIC_ACQUIRE) > 0 || now_us() - last < HANDOFF_QUIET_US)
+            && now_us() - start < HANDOFF_DRAIN_US) {
+        zmq_poll(items, 2, 1);
+        forward_replies(sock, replies);
+        
+        Task t;
+        int rc;
+        while ((rc = recv_task(sock, &t)) >= 0) {
+            if (rc == 0) {
+                send_busy(sock, &t, HANDOFF_RETRY_MS);
+                busy++;
+            }
+            last = now_us();
+        }
+    }
+    forward_replies(sock, replies);
+    
+    for (int i = 0; i < cfg.ep_cnt; i++) {
+        zmq_unbind(sock, cfg.ep[i].bound);
+    }
+    
+    pthread_mutex_lock(&srv_lock);
+    long bytes = store_save(&plays, cfd);
+    int games = plays.cnt;
+    pthread_mutex_unlock(&srv_lock);
+    
+    // Ждём, пока новый процесс займёт адреса
+    int ok = 0;
+    while (bytes >= 0 && now_us() - start < (uint64_t)HANDOFF_TIMEOUT * 1000) {
+        zmq_poll(items, 3, 10);
+        
+        Task t;
+        int rc;
+        while ((rc = recv_task(sock, &t)) >= 0) {
+            if (rc == 0) {
+                send_busy(sock, &t, HANDOFF_RETRY_MS);
+                busy++;
+            }
+        }
+        
+        if (items[2].revents & ZMQ_POLLIN) {
+            ok = read(cfd, cmd, 4) == 4 && memcmp(cmd, "DONE", 4) == 0;
+            break;
+        }
+    }
+    close(cfd);
+    
+    if (!ok) {
+        // Новый процесс мог успеть занять адреса перед сбоем - ждём, пока он их освободит
+        printf("Передача не удалась, занимаем адреса обратно\n");
+        if (bind_all(sock, HANDOFF_TIMEOUT) != 0) {
+            printf("Не удалось занять адреса после неудачной передачи, сервер останавливается\n");
+            return -1;
+        }
+        return 0;
+    }
+    
+    printf("Передано игр: %d (%ld байт) за %.1f мс, отклонено запросов: %ld\n",
+        games, bytes, (now_us() - start) / 1000.0, busy);
+    return 1;
+}
+
+// Новый процесс: забирает игры у работающего сервера и занимает его адреса
+// Параметры: sock - ROUTER сокет (ещё не привязанный)
+// Возвращает: 0 при успехе, -1 при ошибке
+int handoff_take(void *sock) {
+    int fd = handoff_connect(cfg.handoff);
+    if (fd < 0) {
+        printf("Нет работающего сервера на %s\n", cfg.handoff);
+        return -1;
+    }
+    
+    uint64_t start = now_us();
+    
+    if (write(fd, "TAKE", 4) != 4 || store_load(&plays, fd) != 0) {
+        printf("Не удалось получить игры\n");
+        close(fd);
+        return -1;
+    }
+    uint64_t loaded = now_us();
+    
+    if (bind_all(sock, HANDOFF_TIMEOUT) != 0) {
+        close(fd);
+        return -1;
+    }
+    
+    int rc = write(fd, "DONE", 4) == 4 ? 0 : -1;
+    close(fd);
+    
+    printf("Получено игр: %d за %.1f мс, адреса заняты через %.1f мс\n",
+        plays.cnt, (loaded - start) / 1000.0, (now_us() - start) / 1000.0);
+    return rc;
+}
+
 // Точка входа сервера: инициализация ZeroMQ ROUTER сокета, основной цикл приема сообщений
-// Запускает обработку на слушающем порте tcp://*:5555, создает потоки для каждого клиента
-// Завершается при SIGINT/SIGTERM
-int main() {
+// Главный поток принимает запросы, проверяет лимиты и кладёт их в ограниченную очередь;
+// пул рабочих потоков обрабатывает очередь. Каждый запрос получает ответ:
+// результат или быстрый отказ "busy" с retry_ms. Завершается при SIGINT/SIGTERM
+int main(int argc, char **argv) {
+    if (parse_args(argc, argv) != 0) {
+        printf("Использование: %s [-c файл] [-e адрес[?опции]]... [-w потоков] [-q размер очереди] [-B пачка] "
+            "[-r запр/с на клиента] [-b всплеск] [-s SNDHWM] [-R RCVHWM] [-H путь] [-T] [-t трасса.json] [-x каталог]\n", argv[0]);
+        printf("Опции адреса: sndhwm, rcvhwm, linger, keepalive, keepalive_idle, keepalive_intvl\n");
+        printf("Пример: -e tcp://*:5555?keepalive=1 -e ipc:///tmp/bulls.sock (адреса tcp:// и ipc://)\n");
+        printf("Перезапуск без потери игр: новый процесс с -T забирает игры у старого через -H путь\n");
+        return 1;
+    }
+    
     printf("==============================\n");
     printf("  Быки и Коровы (слова)\n");
     printf("==============================\n\n");
     
+    // Без -T путь передачи должен быть свободен: иначе второй сервер (на других адресах)
+    // молча забрал бы сокет у работающего, и тот больше не смог бы передать игры
+    if (!cfg.takeover && handoff_alive(cfg.handoff)) {
+        printf("На %s уже работает сервер: перезапуск - с -T, второй сервер - с другим -H\n", cfg.handoff);
+        return 1;
+    }
+    
+    store_init(&plays);
+    
+    if (cfg.export[0] && export_start(cfg.export) != 0) {
+        return 1;
+    }
+    
     signal(SIGINT, sig_handler);
     signal(SIGTERM, sig_handler);
+    // sigaction, а не signal: обработчик должен пережить повторные переключения
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = trace_sig;
+    sigaction(SIGUSR1, &sa, NULL);
+    trace_thread("main");
+    trace_on = cfg.trace_start;
     
     zmq_ctx = zmq_ctx_new();
     void *sock = zmq_socket(zmq_ctx, ZMQ_ROUTER);
+    int rcv_timeout = RECV_TIMEOUT;
+    zmq_setsockopt(sock, ZMQ_RCVTIMEO, &rcv_timeout, sizeof(rcv_timeout));
+    
+    void *replies = zmq_socket(zmq_ctx, ZMQ_PULL);
+    zmq_bind(replies, REPLY_ADDR);
+    
+    queue = malloc((size_t)cfg.queue_max * sizeof(Task*));
+    pthread_t *threads = malloc((size_t)cfg.workers * sizeof(pthread_t));
+    if (queue == NULL || threads == NULL) {
+        printf("Нет памяти\n");
+        return 1;
+    }
+    
+    for (int i = 0; i < cfg.workers; i++) {
+        pthread_create(&threads[i], NULL, worker_thread, NULL);
+    }
     
-    int rc = zmq_bind(sock, ADDR);
-    if (rc != 0) {
-        printf("Bind error\n");
+    // Рабочие потоки уже запущены, поэтому после bind запросы обслуживаются сразу
+    if ((cfg.takeover ? handoff_take(sock) : bind_all(sock, 0)) != 0) {
         return 1;
     }
     
-    printf("Сервер на %s\n", ADDR);
-    printf("Потоки: до %d\n", MAX_THREAD);
+    int lfd = handoff_listen(cfg.handoff);
+    int handed_off = 0;
+    int unbound = 0;
+    
+    for (int i = 0; i < cfg.ep_cnt; i++) {
+        printf("Сервер на %s\n", cfg.ep[i].addr);
+    }
+    printf("Потоки: %d, очередь: %d, пачка: %d\n", cfg.workers, cfg.queue_max, cfg.batch);
+    if (cfg.rate > 0) {
+        printf("Лимит: %.0f запр/с на клиента (всплеск %.0f)\n", cfg.rate, cfg.burst);
+    }
+    if (lfd >= 0) {
+        printf("Передача игр при перезапуске: %s\n", cfg.handoff);
+    }
+    if (cfg.export[0]) {
+        printf("Выгрузка законченных игр в %s\n", cfg.export);
+    }
+    printf("Трасса: kill -USR1 %d включает/выключает запись в %s%s\n",
+        (int)getpid(), cfg.trace, trace_on ? " (включена)" : "");
     printf("Ожидание клиентов...\n\n");
     
-    int timeout = 1000;
-    zmq_setsockopt(sock, ZMQ_RCVTIMEO, &timeout, sizeof(timeout));
+    zmq_pollitem_t items[3] = {
+        {sock, 0, ZMQ_POLLIN, 0},
+        {replies, 0, ZMQ_POLLIN, 0},
+        {NULL, lfd, ZMQ_POLLIN, 0},
+    };
     
-    pthread_t threads[MAX_THREAD];
-    int thread_idx = 0;
+    long accepted = 0, shed = 0, limited = 0, malformed = 0;
+    uint32_t seq = 0;
     
     while (srv_on) {
-        Task *task = malloc(sizeof(Task));
-        if (task == NULL) {
-            continue;
+        if (trace_flip) {
+            trace_flip = 0;
+            trace_on = !trace_on;
+            if (trace_on) {
+                printf("Трассировка включена\n");
+            } else {
+                trace_save();
+            }
         }
         
-        task->s = sock;
-        task->id_len = zmq_recv(sock, task->id, 256, ZMQ_DONTWAIT);
-        
-        if (task->id_len == -1) {
-            free(task);
-            struct timespec ts;
-            ts.tv_sec = 0;
-            ts.tv_nsec = 100000000; // 100ms
-            nanosleep(&ts, NULL);
+        if (zmq_poll(items, lfd >= 0 ? 3 : 2, 1000) <= 0) {
             continue;
         }
         
-        char delim[10];
-        zmq_recv(sock, delim, 10, 0);
-        zmq_recv(sock, &task->req, sizeof(Msg), 0);
-        
-        if (thread_idx >= MAX_THREAD) {
-            printf("Достигнут лимит потоков\n");
-            free(task);
-            continue;
+        // Готовые ответы от рабочих потоков
+        if (items[1].revents & ZMQ_POLLIN) {
+            forward_replies(sock, replies);
         }
         
-        pthread_create(&threads[thread_idx], NULL, client_thread, task);
-        thread_idx++;
+        // Новый процесс забирает игры
+        if (lfd >= 0 && (items[2].revents & ZMQ_POLLIN)) {
+            int given = handoff_give(lfd, sock, replies);
+            if (given != 0) {
+                handed_off = given == 1;
+                unbound = given == -1;
+                srv_on = 0;
+                break;
+            }
+        }
         
-        if (thread_idx >= MAX_THREAD) {
-            thread_idx = 0;
+        // Новые запросы: забираем всё, что накопилось (не больше пачки), и кладём в очередь разом
+        if (items[0].revents & ZMQ_POLLIN) {
+            Task *batch[MAX_BATCH];
+            int n = 0;
+            
+            while (n < cfg.batch) {
+                uint64_t t = TRACE_START();
+                Task *task = malloc(sizeof(Task));
+                if (task == NULL) {
+                    break;
+                }
+                
+                int rc = recv_task(sock, task);
+                if (rc != 0) {
+                    free(task);
+                    if (rc > 0) {
+                        malformed++;
+                        continue;
+                    }
+                    break;
+                }
+                
+                task->seq = ++seq;
+                trace_key(task->seq);
+                
+                int retry_ms = 0;
+                if (!rate_ok(task, &retry_ms)) {
+                    send_busy(sock, task, retry_ms);
+                    free(task);
+                    limited++;
+                    continue;
+                }
+                
+                // Время в очереди считает рабочий поток от этой отметки
+                task->queued = TRACE_START();
+                TRACE_END("recv", t);
+                batch[n++] = task;
+            }
+            
+            int k = queue_push(batch, n);
+            accepted += k;
+            
+            for (int i = k; i < n; i++) {
+                send_busy(sock, batch[i], BUSY_RETRY_MS);
+                free(batch[i]);
+                shed++;
+            }
         }
     }
     
+    // Будим рабочие потоки, чтобы они увидели srv_on == 0
+    pthread_mutex_lock(&queue_lock);
+    pthread_cond_broadcast(&queue_cond);
+    pthread_mutex_unlock(&queue_lock);
+    
+    for (int i = 0; i < cfg.workers; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    
+    while (queue_len > 0) {
+        free(queue[queue_head]);
+        queue_head = (queue_head + 1) % cfg.queue_max;
+        queue_len--;
+    }
+    
+    printf("Принято: %ld, отклонено (очередь): %ld, отклонено (лимит): %ld, неверный формат: %ld\n",
+        accepted, shed, limited, malformed);
+    
+    // Рабочие потоки остановлены - новых игр в очереди выгрузки не появится
+    export_stop();
+    
+    if (trace_on) {
+        trace_on = 0;
+        trace_save();
+    }
+    
+    if (lfd >= 0) {
+        close(lfd);
+        // После передачи путь уже принадлежит новому процессу
+        if (!handed_off) {
+            unlink(cfg.handoff);
+        }
+    }
+    
+    int linger = 1000;
+    zmq_setsockopt(sock, ZMQ_LINGER, &linger, sizeof(linger));
+    zmq_close(replies);
     zmq_close(sock);
     zmq_ctx_destroy(zmq_ctx);
+    store_free(&plays);
+    free(queue);
+    free(threads);
     
     printf("Сервер остановлен\n");
-    return 0;
-}
+    return unbound ? 1 : 0;
+}
\ No newline at end of file
@@ -0,0 +1,208 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "colfile.h"
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#define HIST_MAX 1024   // попыток больше этого - в последнюю ячейку
+
+// Сводке нужны только эти столбцы: названия, секреты и логины не разбираются
+#define COLS (COL_BIT(COL_WORD_LEN) | COL_BIT(COL_PLAYERS) | COL_BIT(COL_WON) | COL_BIT(COL_TRIES))
+
+// Сводка по одной длине слова
+typedef struct {
+    uint64_t games;
+    uint64_t solved;        // игры, где угадал хотя бы один
+    uint64_t players;
+    uint64_t winners;
+    uint64_t win_tries;
+    uint64_t hist[HIST_MAX + 1];    // попыток до победы
+} LenStats;
+
+LenStats by_len[MAX_WORD_LENGTH + 1];
+uint64_t files_cnt = 0;
+uint64_t blocks_cnt = 0;
+uint64_t bytes_cnt = 0;
+uint64_t bad_cnt = 0;
+
+// Учитывает прочитанный блок: проход по столбцам, без сборки записей игр
+void add_block(const ColBlock *b) {
+    uint32_t p = 0;
+
+    for (uint32_t i = 0; i < b->rows; i++) {
+        uint32_t len = b->word_len[i];
+        uint32_t n = b->players[i];
+        if (len > MAX_WORD_LENGTH || n > MAX_GAME_PLAYERS || p + n > b->prows) {
+            bad_cnt++;
+            p += n;
+            continue;
+        }
+
+        LenStats *s = &by_len[len];
+        s->games++;
+        s->players += n;
+        s->solved += b->won[i] != 0;
+
+        for (uint32_t u = 0; u < n; u++, p++) {
+            if (b->won[i] & (1u << u)) {
+                uint32_t t = b->tries[p];
+                s->winners++;
+                s->win_tries += t;
+                s->hist[t < HIST_MAX ? t : HIST_MAX]++;
+            }
+        }
+    }
+}
+
+// Читает один сегмент
+void read_file(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        printf("Не удалось открыть %s\n", path);
+        return;
+    }
+
+    ColBlock b;
+    memset(&b, 0, sizeof(b));
+    int rc;
+    while ((rc = col_read_block(f, &b, COLS)) == 1) {
+        add_block(&b);
+        blocks_cnt++;
+    }
+    if (rc < 0) {
+        printf("%s: повреждённый блок, остаток файла пропущен\n", path);
+    }
+
+    bytes_cnt += (uint64_t)ftell(f);
+    files_cnt++;
+    col_block_free(&b);
+    fclose(f);
+}
+
+// Читает файл или все *.col в каталоге
+void read_path(const char *path) {
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        printf("Нет такого пути: %s\n", path);
+        return;
+    }
+    if (!S_ISDIR(st.st_mode)) {
+        read_file(path);
+        return;
+    }
+
+    DIR *d = opendir(path);
+    if (d == NULL) {
+        return;
+    }
+    struct dirent *e;
+    while ((e = readdir(d)) != NULL) {
+        size_t n = strlen(e->d_name);
+        if (n > 4 && strcmp(e->d_name + n - 4, ".col") == 0) {
+            char full[1024];
+            snprintf(full, sizeof(full), "%s/%s", path, e->d_name);
+            read_file(full);
+        }
+    }
+    closedir(d);
+}
+
+// Перцентиль числа попыток по гистограмме
+// Возвращает: число попыток; 0, если победителей нет (как и среднее в отчёте)
+uint32_t hist_pct(const uint64_t *h, uint64_t total, int pct) {
+    if (total == 0) {
+        return 0;
+    }
+    uint64_t need = (total * (uint64_t)pct + 99) / 100, acc = 0;
+    for (uint32_t t = 0; t <= HIST_MAX; t++) {
+        acc += h[t];
+        if (acc >= need) {
+            return t;
+        }
+    }
+    return HIST_MAX;
+}
+
+// Печатает сводку: по длинам слова и общее распределение попыток победителей
+void report(uint64_t elapsed_us) {
+    LenStats all;
+    memset(&all, 0, sizeof(all));
+
+    printf("\nБукв  Игр         Игроков     Побед доля  Игр с победой  Попыток: среднее  p50  p90  p99\n");
+    for (int len = 0; len <= MAX_WORD_LENGTH; len++) {
+        LenStats *s = &by_len[len];
+        if (s->games == 0) {
+            continue;
+        }
+
+        all.games += s->games;
+        all.solved += s->solved;
+        all.players += s->players;
+        all.winners += s->winners;
+        all.win_tries += s->win_tries;
+        for (int t = 0; t <= HIST_MAX; t++) {
+            all.hist[t] += s->hist[t];
+        }
+
+        printf("%-5d %-11llu %-11llu %9.1f%%  %12.1f%%  %16.2f %4u %4u %4u\n",
+            len, (unsigned long long)s->games, (unsigned long long)s->players,
+            s->players ? 100.0 * s->winners / s->players : 0.0,
+            100.0 * s->solved / s->games,
+            s->winners ? (double)s->win_tries / s->winners : 0.0,
+            hist_pct(s->hist, s->winners, 50), hist_pct(s->hist, s->winners, 90),
+            hist_pct(s->hist, s->winners, 99));
+    }
+
+    // Распределение попыток до победы, ячейки растут примерно вдвое
+    static const uint32_t edges[] = {1, 2, 3, 5, 9, 17, 33, 65, 101, HIST_MAX + 1};
+    printf("\nПопыток до победы (все длины):\n");
+    uint32_t from = 0;
+    for (size_t k = 0; k < sizeof(edges) / sizeof(edges[0]); k++) {
+        uint64_t c = 0;
+        for (uint32_t t = from; t < edges[k]; t++) {
+            c += all.hist[t];
+        }
+        if (c > 0) {
+            double share = all.winners ? (double)c / all.winners : 0.0;
+            char bar[41];
+            int w = (int)(share * 40 + 0.5);
+            memset(bar, '#', (size_t)w);
+            bar[w] = 0;
+            if (edges[k] - from == 1) {
+                printf("  %-9u %10llu %5.1f%% %s\n", from, (unsigned long long)c, 100 * share, bar);
+            } else {
+                char range[24];
+                snprintf(range, sizeof(range), "%u-%u", from, edges[k] - 1);
+                printf("  %-9s %10llu %5.1f%% %s\n", range, (unsigned long long)c, 100 * share, bar);
+            }
+        }
+        from = edges[k];
+    }
+
+    printf("\nФайлов: %llu, блоков: %llu, %.1f МБ (%.1f байт/игру)\n",
+        (unsigned long long)files_cnt, (unsigned long long)blocks_cnt, bytes_cnt / 1048576.0,
+        all.games ? (double)bytes_cnt / all.games : 0.0);
+    printf("Игр: %llu, игроков: %llu, побед: %.1f%%; прочитано за %.3f с (%.0f игр/с)\n",
+        (unsigned long long)all.games, (unsigned long long)all.players,
+        all.players ? 100.0 * all.winners / all.players : 0.0,
+        elapsed_us / 1e6, elapsed_us ? all.games * 1e6 / elapsed_us : 0.0);
+    if (bad_cnt > 0) {
+        printf("Пропущено некорректных игр: %llu\n", (unsigned long long)bad_cnt);
+    }
+}
+
+// Точка входа: сводка по выгрузке законченных игр (файлы .col или каталоги с ними)
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        printf("Использование: %s сегмент.col|каталог...\n", argv[0]);
+        return 1;
+    }
+
+    uint64_t start = now_us();
+    for (int i = 1; i < argc; i++) {
+        read_path(argv[i]);
+    }
+    report(now_us() - start);
+    return 0;
+}
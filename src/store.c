@@ -0,0 +1,606 @@
+#include "store.h"
+
+#include <unistd.h>
+
+#define STORE_MAGIC 0x33484342u     // "BCH3"
+#define OPEN_PROBE 16               // сколько игр просмотреть в подборе, прежде чем создать новую
+#define IO_BUF 65536
+
+// Инициализирует пустое хранилище
+// Параметры: st - хранилище
+void store_init(PlayStore *st) {
+    memset(st, 0, sizeof(PlayStore));
+    memset(st->open_head, -1, sizeof(st->open_head));
+    intern_init(&st->names);
+}
+
+// Освобождает память хранилища
+// Параметры: st - хранилище
+void store_free(PlayStore *st) {
+    free(st->run);
+    free(st->slots);
+    free(st->users_cnt);
+    free(st->ok_mask);
+    free(st->id);
+    free(st->by_id);
+    free(st->last_act);
+    free(st->word_len);
+    free(st->secret);
+    free(st->login);
+    free(st->tries);
+    free(st->last_req);
+    free(st->won_mask);
+    free(st->open_next);
+    free(st->open_prev);
+    free(st->open_at);
+    free(st->quick_req);
+    free(st->quick_game);
+    intern_free(&st->names);
+    memset(st, 0, sizeof(PlayStore));
+}
+
+#define GROW(field, cap) do { \
+        void *tmp = realloc(st->field, (size_t)(cap) * sizeof(*st->field)); \
+        if (tmp == NULL) return -1; \
+        st->field = tmp; \
+    } while (0)
+
+// Увеличивает ёмкость всех массивов вдвое
+// Параметры: st - хранилище
+// Возвращает: 0 при успехе, -1 при нехватке памяти
+static int store_grow(PlayStore *st) {
+    int cap = st->cap ? st->cap * 2 : 64;
+    if (cap > MAX_PLAYS) {
+        cap = MAX_PLAYS;
+    }
+
+    GROW(run, cap);
+    GROW(slots, cap);
+    GROW(users_cnt, cap);
+    GROW(ok_mask, cap);
+    GROW(id, cap);
+    GROW(last_act, cap);
+    GROW(word_len, cap);
+    GROW(secret, cap);
+    GROW(login, cap);
+    GROW(tries, cap);
+    GROW(last_req, cap);
+    GROW(won_mask, cap);
+    GROW(open_next, cap);
+    GROW(open_prev, cap);
+    GROW(open_at, cap);
+
+    st->cap = cap;
+    return 0;
+}
+
+#undef GROW
+
+// Слот индекса by_id, с которого начинается поиск игры с названием id
+static uint32_t index_slot(Name id, uint32_t cap) {
+    return (id * 2654435761u) & (cap - 1);
+}
+
+// Кладёт игру g в индекс by_id (место под неё уже есть)
+static void index_put(PlayStore *st, int g) {
+    uint32_t mask = st->by_id_cap - 1;
+    uint32_t i = index_slot(st->id[g], st->by_id_cap);
+    while (st->by_id[i] != -1) {
+        i = (i + 1) & mask;
+    }
+    st->by_id[i] = g;
+}
+
+// Строит индекс by_id заново по столбцу id с запасом под need игр
+// (заполнение не больше половины, чтобы цепочки проб оставались короткими)
+// Параметры: st - хранилище, need - сколько игр должно поместиться
+// Возвращает: 0 при успехе, -1 при нехватке памяти
+static int index_build(PlayStore *st, int need) {
+    uint32_t cap = 1024;
+    while (cap < (uint32_t)need * 2) {
+        cap *= 2;
+    }
+
+    int *by_id = malloc((size_t)cap * sizeof(int));
+    if (by_id == NULL) {
+        return -1;
+    }
+    memset(by_id, -1, (size_t)cap * sizeof(int));
+
+    free(st->by_id);
+    st->by_id = by_id;
+    st->by_id_cap = cap;
+    for (int g = 0; g < st->cnt; g++) {
+        index_put(st, g);
+    }
+    return 0;
+}
+
+// Переносит игру в список, соответствующий её числу свободных мест,
+// или убирает из списков, если игра закончена или заполнена. O(1)
+// Параметры: st - хранилище, g - индекс игры
+static void open_update(PlayStore *st, int g) {
+    int len = st->word_len[g];
+    int free_cnt = st->run[g] ? st->slots[g] - st->users_cnt[g] : 0;
+
+    if (st->open_at[g] == free_cnt) {
+        return;
+    }
+
+    // Убираем из старого списка
+    int k = st->open_at[g];
+    if (k != 0) {
+        int prev = st->open_prev[g];
+        int next = st->open_next[g];
+        if (prev != -1) {
+            st->open_next[prev] = next;
+        } else {
+            st->open_head[len][k] = next;
+        }
+        if (next != -1) {
+            st->open_prev[next] = prev;
+        }
+        if (st->open_head[len][k] == -1) {
+            st->open_bits[len] &= (uint16_t)~(1u << k);
+        }
+    }
+
+    // Кладём в начало нового
+    st->open_at[g] = (uint8_t)free_cnt;
+    if (free_cnt > 0) {
+        int head = st->open_head[len][free_cnt];
+        st->open_prev[g] = -1;
+        st->open_next[g] = head;
+        if (head != -1) {
+            st->open_prev[head] = g;
+        }
+        st->open_head[len][free_cnt] = g;
+        st->open_bits[len] |= (uint16_t)(1u << free_cnt);
+    }
+}
+
+// Ищет игру по названию: строка переводится в дескриптор, дескриптор - в игру через индекс by_id. O(1)
+// Параметры: st - хранилище, name - название игры
+// Возвращает: индекс игры или -1
+int store_find(PlayStore *st, const char *name) {
+    Name id = intern_find(&st->names, name);
+    if (id == NO_NAME || st->by_id_cap == 0) {
+        return -1;
+    }
+
+    uint32_t mask = st->by_id_cap - 1;
+    for (uint32_t i = index_slot(id, st->by_id_cap); st->by_id[i] != -1; i = (i + 1) & mask) {
+        if (st->id[st->by_id[i]] == id) {
+            return st->by_id[i];
+        }
+    }
+
+    return -1;
+}
+
+// Добавляет новую игру (без игроков)
+// Параметры: st - хранилище, name - название, slots - максимум игроков, word_len - длина слова
+// Возвращает: индекс игры или -1 если места нет
+int store_add(PlayStore *st, const char *name, int slots, int word_len) {
+    if (st->cnt >= MAX_PLAYS) {
+        return -1;
+    }
+
+    if (st->cnt == st->cap && store_grow(st) != 0) {
+        return -1;
+    }
+
+    if ((uint32_t)(st->cnt + 1) * 2 > st->by_id_cap && index_build(st, st->cnt + 1) != 0) {
+        return -1;
+    }
+
+    Name id = intern(&st->names, name);
+    if (id == NO_NAME) {
+        return -1;
+    }
+
+    int g = st->cnt++;
+    st->run[g] = 1;
+    st->slots[g] = (uint8_t)slots;
+    st->users_cnt[g] = 0;
+    st->ok_mask[g] = 0;
+    st->id[g] = id;
+    st->last_act[g] = (uint32_t)time(NULL);
+    st->word_len[g] = (uint8_t)word_len;
+    st->secret[g][0] = 0;
+    memset(st->tries[g], 0, sizeof(st->tries[g]));
+    st->won_mask[g] = 0;
+    st->open_at[g] = 0;
+    open_update(st, g);
+    index_put(st, g);
+
+    return g;
+}
+
+// Ищет игрока в игре по логину
+// Параметры: st - хранилище, g - индекс игры, login - имя игрока
+// Возвращает: номер игрока в игре или -1
+int store_find_user(PlayStore *st, int g, const char *login) {
+    Name n = intern_find(&st->names, login);
+    if (n == NO_NAME) {
+        return -1;
+    }
+
+    for (int i = 0; i < st->users_cnt[g]; i++) {
+        if (st->login[g][i] == n) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+// Добавляет активного игрока в игру (проверка мест - на вызывающем)
+// Параметры: st - хранилище, g - индекс игры, login - имя игрока
+// Возвращает: номер игрока или -1 при нехватке памяти
+int store_add_user(PlayStore *st, int g, const char *login) {
+    Name n = intern(&st->names, login);
+    if (n == NO_NAME) {
+        return -1;
+    }
+
+    int u = st->users_cnt[g]++;
+    st->login[g][u] = n;
+    st->tries[g][u] = 0;
+    st->last_req[g][u] = 0;
+    st->ok_mask[g] |= (uint16_t)(1u << u);
+    store_touch(st, g);
+    open_update(st, g);
+
+    return u;
+}
+
+// Считает активных игроков в игре
+// Параметры: st - хранилище, g - индекс игры
+// Возвращает: количество игроков с поднятым битом в ok_mask
+int store_active(PlayStore *st, int g) {
+    return __builtin_popcount(st->ok_mask[g]);
+}
+
+// Обновляет время последнего действия в игре
+// Параметры: st - хранилище, g - индекс игры
+void store_touch(PlayStore *st, int g) {
+    st->last_act[g] = (uint32_t)time(NULL);
+}
+
+// Завершает игру и убирает её из подбора
+// Параметры: st - хранилище, g - индекс игры
+void store_end(PlayStore *st, int g) {
+    st->run[g] = 0;
+    open_update(st, g);
+}
+
+// Выбирает игру для MSG_QUICK_JOIN: идущую игру с нужной длиной слова
+// и наименьшим числом свободных мест, чтобы игры заполнялись, а не дробились.
+// Игры, где игрок уже был (вышел или угадал), пропускаются: вернуться в них нельзя.
+// Обычно это первая игра списка; просматривается не больше OPEN_PROBE игр
+// Параметры: st - хранилище, word_len - длина слова, login - имя игрока
+// Возвращает: индекс игры или -1, если подходящих нет
+int store_open_best(PlayStore *st, int word_len, const char *login) {
+    Name n = intern_find(&st->names, login);
+    int probe = 0;
+
+    for (uint16_t bits = st->open_bits[word_len]; bits != 0; bits &= (uint16_t)(bits - 1)) {
+        for (int g = st->open_head[word_len][__builtin_ctz(bits)]; g != -1; g = st->open_next[g]) {
+            int seen = 0;
+            for (int u = 0; n != NO_NAME && u < st->users_cnt[g]; u++) {
+                seen |= st->login[g][u] == n;
+            }
+            if (!seen) {
+                return g;
+            }
+            if (++probe == OPEN_PROBE) {
+                return -1;
+            }
+        }
+    }
+    return -1;
+}
+
+// Ищет игру, которую игрок получил запросом MSG_QUICK_JOIN с этим req_id
+// Параметры: st - хранилище, login - имя игрока, req_id - номер запроса (0 - без номера)
+// Возвращает: индекс игры, если это повтор последнего запроса игрока, иначе -1
+int store_quick_find(PlayStore *st, const char *login, uint32_t req_id) {
+    Name n = intern_find(&st->names, login);
+    if (req_id == 0 || n == NO_NAME || n >= st->quick_cap || st->quick_req[n] != req_id
+            || st->quick_game[n] >= st->cnt) {
+        return -1;
+    }
+    return st->quick_game[n];
+}
+
+// Запоминает, что игрок u игры g попал в неё запросом MSG_QUICK_JOIN с номером req_id
+// Параметры: st - хранилище, g - индекс игры, u - номер игрока, req_id - номер запроса
+// Возвращает: 0 при успехе, -1 при нехватке памяти
+int store_quick_set(PlayStore *st, int g, int u, uint32_t req_id) {
+    Name n = st->login[g][u];
+
+    if (n >= st->quick_cap) {
+        uint32_t cap = st->quick_cap ? st->quick_cap : 1024;
+        while (cap <= n) {
+            cap *= 2;
+        }
+        uint32_t *req = realloc(st->quick_req, (size_t)cap * sizeof(uint32_t));
+        if (req == NULL) {
+            return -1;
+        }
+        st->quick_req = req;
+        int *game = realloc(st->quick_game, (size_t)cap * sizeof(int));
+        if (game == NULL) {
+            return -1;
+        }
+        st->quick_game = game;
+        memset(st->quick_req + st->quick_cap, 0, (size_t)(cap - st->quick_cap) * sizeof(uint32_t));
+        st->quick_cap = cap;
+    }
+
+    st->quick_req[n] = req_id;
+    st->quick_game[n] = g;
+    return 0;
+}
+
+// Возвращает название игры
+const char *store_title(PlayStore *st, int g) {
+    return intern_str(&st->names, st->id[g]);
+}
+
+// Возвращает логин игрока u в игре g
+const char *store_login(PlayStore *st, int g, int u) {
+    return intern_str(&st->names, st->login[g][u]);
+}
+
+// Буферизованный поток поверх файлового дескриптора (сокет передачи состояния)
+typedef struct {
+    int fd;
+    int err;
+    size_t len;
+    size_t pos;
+    long total;
+    char buf[IO_BUF];
+} Stream;
+
+// Пишет буфер в fd целиком
+static int write_all(int fd, const void *p, size_t n) {
+    const char *c = p;
+    while (n > 0) {
+        ssize_t k = write(fd, c, n);
+        if (k <= 0) {
+            return -1;
+        }
+        c += k;
+        n -= (size_t)k;
+    }
+    return 0;
+}
+
+static void out_flush(Stream *o) {
+    if (!o->err && o->len > 0 && write_all(o->fd, o->buf, o->len) != 0) {
+        o->err = 1;
+    }
+    o->len = 0;
+}
+
+// Пишет n байт в поток; большие массивы идут в fd напрямую, мимо буфера
+static void out_put(Stream *o, const void *p, size_t n) {
+    o->total += (long)n;
+    if (o->len + n > IO_BUF) {
+        out_flush(o);
+    }
+    if (n > IO_BUF) {
+        if (!o->err && write_all(o->fd, p, n) != 0) {
+            o->err = 1;
+        }
+        return;
+    }
+    memcpy(o->buf + o->len, p, n);
+    o->len += n;
+}
+
+// Читает ровно n байт из потока
+static void in_get(Stream *in, void *p, size_t n) {
+    char *c = p;
+    while (n > 0 && !in->err) {
+        if (in->pos == in->len) {
+            ssize_t k = read(in->fd, in->buf, IO_BUF);
+            if (k <= 0) {
+                in->err = 1;
+                break;
+            }
+            in->len = (size_t)k;
+            in->pos = 0;
+        }
+        size_t m = in->len - in->pos < n ? in->len - in->pos : n;
+        memcpy(c, in->buf + in->pos, m);
+        in->pos += m;
+        c += m;
+        n -= m;
+    }
+}
+
+#define PUT_COL(field) out_put(o, st->field, (size_t)st->cnt * sizeof(*st->field))
+#define GET_COL(field) in_get(in, st->field, (size_t)cnt * sizeof(*st->field))
+
+// Пишет всё хранилище в fd компактным двоичным потоком:
+// строки пула в порядке дескрипторов, затем каждый массив игр целиком (по столбцам).
+// Вызывается под srv_lock
+// Параметры: st - хранилище, fd - куда писать
+// Возвращает: число записанных байт или -1 при ошибке
+long store_save(PlayStore *st, int fd) {
+    Stream *o = calloc(1, sizeof(Stream));
+    if (o == NULL) {
+        return -1;
+    }
+    o->fd = fd;
+
+    uint32_t hdr[2] = {STORE_MAGIC, st->names.cnt};
+    out_put(o, hdr, sizeof(hdr));
+
+    for (Name n = 1; n <= st->names.cnt; n++) {
+        const char *s = intern_str(&st->names, n);
+        uint32_t len = (uint32_t)strlen(s);
+        out_put(o, &len, sizeof(len));
+        out_put(o, s, len);
+    }
+
+    uint32_t cnt = (uint32_t)st->cnt;
+    out_put(o, &cnt, sizeof(cnt));
+
+    PUT_COL(run);
+    PUT_COL(slots);
+    PUT_COL(users_cnt);
+    PUT_COL(ok_mask);
+    PUT_COL(id);
+    PUT_COL(last_act);
+    PUT_COL(word_len);
+    PUT_COL(secret);
+    PUT_COL(login);
+    PUT_COL(tries);
+    PUT_COL(last_req);
+    PUT_COL(won_mask);
+
+    // Последние запросы подбора: по логинам, а не по играм
+    out_put(o, &st->quick_cap, sizeof(st->quick_cap));
+    out_put(o, st->quick_req, (size_t)st->quick_cap * sizeof(uint32_t));
+    out_put(o, st->quick_game, (size_t)st->quick_cap * sizeof(int));
+
+    out_flush(o);
+
+    long total = o->err ? -1 : o->total;
+    free(o);
+    return total;
+}
+
+// Проверяет загруженную игру: по этим полям строятся списки подбора и индекс,
+// и ими индексируются массивы, поэтому чужие значения до них допускать нельзя
+// Параметры: st - хранилище, g - индекс игры
+// Возвращает: 1 если все поля в допустимых пределах, 0 иначе
+static int row_ok(PlayStore *st, int g) {
+    int len = st->word_len[g];
+    if (st->run[g] > 1 || len < MIN_WORD_LENGTH || len > MAX_WORD_LENGTH
+            || st->slots[g] == 0 || st->slots[g] > MAX_GAME_PLAYERS || st->users_cnt[g] > st->slots[g]
+            || st->id[g] == NO_NAME || st->id[g] > st->names.cnt
+            || st->secret[g][len] != 0 || !word_chars_ok(st->secret[g], len)) {
+        return 0;
+    }
+    for (int u = 0; u < st->users_cnt[g]; u++) {
+        if (st->login[g][u] == NO_NAME || st->login[g][u] > st->names.cnt) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Читает хранилище, записанное store_save, в пустое хранилище
+// Строки интернируются в том же порядке, поэтому дескрипторы совпадают с исходными
+// Параметры: st - пустое хранилище, fd - откуда читать
+// Возвращает: 0 при успехе, -1 при ошибке
+int store_load(PlayStore *st, int fd) {
+    Stream *in = calloc(1, sizeof(Stream));
+    if (in == NULL) {
+        return -1;
+    }
+    in->fd = fd;
+
+    uint32_t hdr[2] = {0, 0};
+    in_get(in, hdr, sizeof(hdr));
+    if (in->err || hdr[0] != STORE_MAGIC) {
+        free(in);
+        return -1;
+    }
+
+    char *s = NULL;
+    for (uint32_t n = 1; n <= hdr[1] && !in->err; n++) {
+        uint32_t len = 0;
+        in_get(in, &len, sizeof(len));
+        char *tmp = realloc(s, (size_t)len + 1);
+        if (tmp == NULL) {
+            in->err = 1;
+            break;
+        }
+        s = tmp;
+        in_get(in, s, len);
+        s[len] = 0;
+        if (in->err || intern(&st->names, s) != n) {
+            in->err = 1;
+        }
+    }
+    free(s);
+
+    uint32_t cnt = 0;
+    in_get(in, &cnt, sizeof(cnt));
+    if (cnt > MAX_PLAYS) {
+        in->err = 1;
+    }
+    while (!in->err && st->cap < (int)cnt) {
+        if (store_grow(st) != 0) {
+            in->err = 1;
+        }
+    }
+
+    if (!in->err) {
+        GET_COL(run);
+        GET_COL(slots);
+        GET_COL(users_cnt);
+        GET_COL(ok_mask);
+        GET_COL(id);
+        GET_COL(last_act);
+        GET_COL(word_len);
+        GET_COL(secret);
+        GET_COL(login);
+        GET_COL(tries);
+        GET_COL(last_req);
+        GET_COL(won_mask);
+        for (uint32_t g = 0; g < cnt && !in->err; g++) {
+            if (!row_ok(st, (int)g)) {
+                in->err = 1;
+            }
+        }
+    }
+
+    if (!in->err) {
+        st->cnt = (int)cnt;
+
+        // Списки подбора и индекс по названию не передаются - строим заново по загруженным играм
+        for (int g = 0; g < st->cnt; g++) {
+            st->open_at[g] = 0;
+            open_update(st, g);
+        }
+        if (!in->err && index_build(st, st->cnt) != 0) {
+            in->err = 1;
+        }
+    }
+
+    uint32_t qcap = 0;
+    in_get(in, &qcap, sizeof(qcap));
+    if (qcap > hdr[1] * 2 + 1024) {
+        in->err = 1;
+    }
+    if (!in->err && qcap > 0) {
+        st->quick_req = malloc((size_t)qcap * sizeof(uint32_t));
+        st->quick_game = malloc((size_t)qcap * sizeof(int));
+        if (st->quick_req == NULL || st->quick_game == NULL) {
+            in->err = 1;
+        } else {
+            st->quick_cap = qcap;
+            in_get(in, st->quick_req, (size_t)qcap * sizeof(uint32_t));
+            in_get(in, st->quick_game, (size_t)qcap * sizeof(int));
+        }
+        for (uint32_t n = 0; n < qcap && !in->err; n++) {
+            if (st->quick_req[n] != 0 && (st->quick_game[n] < 0 || st->quick_game[n] >= st->cnt)) {
+                in->err = 1;
+            }
+        }
+    }
+
+    int rc = in->err ? -1 : 0;
+    free(in);
+    return rc;
+}
+
+#undef PUT_COL
+#undef GET_COL
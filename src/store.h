@@ -0,0 +1,74 @@
+#ifndef STORE_H
+#define STORE_H
+
+#include "func.h"
+#include "intern.h"
+
+#define MAX_PLAYS (1 << 20)
+
+// Хранилище игр в виде параллельных массивов (structure of arrays)
+// Горячие поля (run, slots, users_cnt, ok_mask, id, last_act) лежат плотно,
+// чтобы сканирование (do_list) читало несколько байт на игру; поиск по названию - через индекс by_id.
+// Холодные поля (длина слова, секрет, логины, попытки) вынесены в отдельные массивы.
+// Названия игр и логины интернированы в names: сравнение - это сравнение дескрипторов
+typedef struct {
+    int cnt;
+    int cap;
+
+    // Горячие поля
+    uint8_t *run;
+    uint8_t *slots;
+    uint8_t *users_cnt;
+    uint16_t *ok_mask;     // бит i - игрок i ещё играет
+    Name *id;              // дескриптор названия игры
+    int *by_id;            // индекс название -> игра: открытая адресация по id, -1 - пустой слот
+    uint32_t by_id_cap;
+    uint32_t *last_act;    // время последнего действия (секунды)
+
+    // Холодные поля
+    uint8_t *word_len;
+    char (*secret)[MAX_WORD_LENGTH + 1];
+    Name (*login)[MAX_GAME_PLAYERS];
+    uint16_t (*tries)[MAX_GAME_PLAYERS];
+    uint32_t (*last_req)[MAX_GAME_PLAYERS];   // req_id последнего засчитанного запроса (вход или попытка)
+    uint16_t *won_mask;    // бит i - игрок i угадал слово
+
+    // Подбор игры (MSG_QUICK_JOIN): идущие игры со свободными местами лежат
+    // в двусвязных списках по длине слова и числу свободных мест;
+    // бит k в open_bits[len] - список с k свободными местами не пуст
+    int *open_next;
+    int *open_prev;
+    uint8_t *open_at;      // число свободных мест, под которым игра в списке (0 - не в списке)
+    int open_head[MAX_WORD_LENGTH + 1][MAX_GAME_PLAYERS + 1];
+    uint16_t open_bits[MAX_WORD_LENGTH + 1];
+
+    // Последний MSG_QUICK_JOIN каждого логина (индекс - дескриптор логина):
+    // req_id и выданная игра, чтобы повтор запроса получил ту же игру
+    uint32_t *quick_req;
+    int *quick_game;
+    uint32_t quick_cap;
+
+    InternPool names;
+} PlayStore;
+
+void store_init(PlayStore *st);
+void store_free(PlayStore *st);
+
+int store_find(PlayStore *st, const char *name);
+int store_add(PlayStore *st, const char *name, int slots, int word_len);
+int store_find_user(PlayStore *st, int g, const char *login);
+int store_add_user(PlayStore *st, int g, const char *login);
+int store_active(PlayStore *st, int g);
+void store_touch(PlayStore *st, int g);
+void store_end(PlayStore *st, int g);
+int store_open_best(PlayStore *st, int word_len, const char *login);
+int store_quick_find(PlayStore *st, const char *login, uint32_t req_id);
+int store_quick_set(PlayStore *st, int g, int u, uint32_t req_id);
+
+const char *store_title(PlayStore *st, int g);
+const char *store_login(PlayStore *st, int g, int u);
+
+long store_save(PlayStore *st, int fd);
+int store_load(PlayStore *st, int fd);
+
+#endif
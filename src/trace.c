@@ -0,0 +1,137 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+typedef struct {
+    const char *name;   // строковый литерал, не копируется
+    uint64_t start;     // нс, CLOCK_MONOTONIC
+    uint32_t dur;       // нс
+    uint32_t key;       // номер запроса
+} Span;
+
+// Буфер одного потока; создаётся при первом отрезке и живёт до конца процесса
+typedef struct TraceBuf {
+    struct TraceBuf *next;
+    int tid;
+    char name[32];
+    uint64_t cnt;       // всего записано; в буфере последние TRACE_SPANS. Меняет только сам поток
+    uint64_t dumped;    // сколько из них уже выгружено; меняет только trace_dump под bufs_lock
+    Span spans[TRACE_SPANS];
+} TraceBuf;
+
+volatile int trace_on = 0;
+
+static TraceBuf *bufs = NULL;
+static int bufs_cnt = 0;
+static pthread_mutex_t bufs_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static __thread TraceBuf *my_buf = NULL;
+static __thread const char *my_name = NULL;
+static __thread uint32_t my_key = 0;
+
+// Текущее монотонное время в наносекундах
+uint64_t trace_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+// Задаёт имя текущего потока для трассы (буфер при этом не выделяется)
+// Параметры: name - строковый литерал
+void trace_thread(const char *name) {
+    my_name = name;
+}
+
+// Задаёт номер запроса, к которому относятся следующие отрезки текущего потока
+void trace_key(uint32_t key) {
+    my_key = key;
+}
+
+// Регистрирует буфер текущего потока
+// Возвращает: буфер или NULL при нехватке памяти
+static TraceBuf *buf_new(void) {
+    TraceBuf *b = calloc(1, sizeof(TraceBuf));
+    if (b == NULL) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&bufs_lock);
+    b->tid = ++bufs_cnt;
+    snprintf(b->name, sizeof(b->name), "%s", my_name ? my_name : "thread");
+    b->next = bufs;
+    bufs = b;
+    pthread_mutex_unlock(&bufs_lock);
+
+    return b;
+}
+
+// Записывает отрезок от start до текущего момента
+// Параметры: name - название этапа (строковый литерал), start - результат TRACE_START
+void trace_span(const char *name, uint64_t start) {
+    uint64_t end = trace_now();
+
+    if (my_buf == NULL && (my_buf = buf_new()) == NULL) {
+        return;
+    }
+
+    TraceBuf *b = my_buf;
+    Span *s = &b->spans[b->cnt % TRACE_SPANS];
+    s->name = name;
+    s->start = start;
+    s->dur = end - start > UINT32_MAX ? UINT32_MAX : (uint32_t)(end - start);
+    s->key = my_key;
+    __atomic_store_n(&b->cnt, b->cnt + 1, __ATOMIC_RELEASE);
+}
+
+// Выгружает в файл отрезки, записанные после прошлой выгрузки
+// Счётчик потока не сбрасывается: поток мог как раз дописывать отрезок и вернул бы старое значение
+// Вызывается при выключенной трассировке: отрезок, который пишется в этот момент, может быть неполным
+// Параметры: path - файл для JSON
+// Возвращает: число выгруженных отрезков или -1 при ошибке
+long trace_dump(const char *path) {
+    FILE *f = fopen(path, "w");
+    if (f == NULL) {
+        return -1;
+    }
+
+    int pid = (int)getpid();
+    long total = 0;
+
+    fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+
+    pthread_mutex_lock(&bufs_lock);
+    for (TraceBuf *b = bufs; b != NULL; b = b->next) {
+        fprintf(f, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+            total || b != bufs ? ",\n" : "", pid, b->tid, b->name);
+
+        uint64_t cnt = __atomic_load_n(&b->cnt, __ATOMIC_ACQUIRE);
+        uint64_t from = cnt - b->dumped > TRACE_SPANS ? cnt - TRACE_SPANS : b->dumped;
+
+        for (uint64_t i = from; i < cnt; i++) {
+            Span *s = &b->spans[i % TRACE_SPANS];
+            fprintf(f, ",\n{\"ph\":\"X\",\"name\":\"%s\",\"pid\":%d,\"tid\":%d,"
+                "\"ts\":%llu.%03u,\"dur\":%u.%03u,\"args\":{\"req\":%u}}",
+                s->name, pid, b->tid,
+                (unsigned long long)(s->start / 1000), (unsigned)(s->start % 1000),
+                s->dur / 1000, s->dur % 1000, s->key);
+            total++;
+        }
+
+        b->dumped = cnt;
+    }
+    pthread_mutex_unlock(&bufs_lock);
+
+    fprintf(f, "\n]}\n");
+
+    if (fclose(f) != 0) {
+        return -1;
+    }
+    return total;
+}
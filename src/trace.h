@@ -0,0 +1,24 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+#define TRACE_SPANS 16384   // отрезков в кольцевом буфере одного потока
+
+// Трассировка этапов обработки запроса.
+// Каждый поток пишет отрезки (название, начало, длительность, номер запроса)
+// в свой кольцевой буфер без блокировок; trace_dump выгружает все буферы
+// в JSON формата Chrome trace events (chrome://tracing, ui.perfetto.dev).
+// Пока trace_on == 0, TRACE_START стоит одну проверку флага
+extern volatile int trace_on;
+
+uint64_t trace_now(void);
+void trace_thread(const char *name);
+void trace_key(uint32_t key);
+void trace_span(const char *name, uint64_t start);
+long trace_dump(const char *path);
+
+#define TRACE_START() (trace_on ? trace_now() : 0)
+#define TRACE_END(name, start) do { if (start) trace_span(name, start); } while (0)
+
+#endif